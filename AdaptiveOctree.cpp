@@ -0,0 +1,616 @@
+#include "AdaptiveOctree.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "MarchingCubes.h"
+#include "ThreadPool.h"
+
+AdaptiveSettings::AdaptiveSettings() {
+	this->maxCellSize = 16;
+	this->surfaceError = 0.25f;
+	this->viewpoint[0] = 0;
+	this->viewpoint[1] = 0;
+	this->viewpoint[2] = 0;
+	this->lodDistance = 0;
+}
+
+// max(funcA, funcB): inside exactly where genUnion keeps the inside of funcA
+class ClippedFunc : public ImplicitFunc {
+public:
+	ClippedFunc(std::shared_ptr<ImplicitFunc> funcA, std::shared_ptr<ImplicitFunc> funcB) {
+		this->funcA = funcA;
+		this->funcB = funcB;
+	}
+
+	GLfloat function(GLfloat x, GLfloat y, GLfloat z) {
+		return std::max(funcA->function(x, y, z), funcB->function(x, y, z));
+	}
+
+	bool isInside(GLfloat x, GLfloat y, GLfloat z) {
+		return function(x, y, z) < 0;
+	}
+
+	void incXoff(float inc) {
+		funcA->incXoff(inc);
+	}
+
+	void incYoff(float inc) {
+		funcA->incYoff(inc);
+	}
+
+	void incZoff(float inc) {
+		funcA->incZoff(inc);
+	}
+
+	void evaluatePoints(const GLfloat *x, const GLfloat *y, const GLfloat *z, GLfloat *out, size_t count) {
+		std::vector<GLfloat> container(count);
+		funcA->evaluatePoints(x, y, z, out, count);
+		funcB->evaluatePoints(x, y, z, container.data(), count);
+		for (size_t n = 0; n < count; ++n) {
+			out[n] = std::max(out[n], container[n]);
+		}
+	}
+
+	void bounds(const GLfloat lo[3], const GLfloat hi[3], GLfloat &min, GLfloat &max) {
+		GLfloat minA, maxA, minB, maxB;
+		funcA->bounds(lo, hi, minA, maxA);
+		funcB->bounds(lo, hi, minB, maxB);
+		min = std::max(minA, minB);
+		max = std::max(maxA, maxB);
+	}
+
+	// the gradient of whichever field is the larger, as the normals of genUnion follow the container on it
+	GLfloat gradient(GLfloat x, GLfloat y, GLfloat z, GLfloat grad[3]) {
+		GLfloat gradB[3];
+		GLfloat a = funcA->gradient(x, y, z, grad);
+		GLfloat b = funcB->gradient(x, y, z, gradB);
+		if (b > a) {
+			std::copy(gradB, gradB + 3, grad);
+			return b;
+		}
+		return a;
+	}
+
+private:
+	std::shared_ptr<ImplicitFunc> funcA;
+	std::shared_ptr<ImplicitFunc> funcB;
+};
+
+// A cube of size lattice cells with its lowest corner at lattice point origin.
+// Child c has origin + size / 2 along x, y and z where bits 1, 2 and 4 of c are
+// set, and is -1 when it lies wholly outside the lattice. A settled leaf is on
+// one side of the surface by the function's bounds and was never sampled.
+struct OctreeNode {
+	GLint origin[3];
+	GLint size;
+	int children[8];
+	bool leaf;
+	bool settled;
+};
+
+// points handed to one evaluatePoints call
+static const size_t POINT_BATCH = 4096;
+// nodes narrower than this, in lattice cells, are sampled without being bounded
+static const GLint MIN_BOUNDED_SIZE = 4;
+
+static void normalize(GLfloat v[3]) {
+	GLfloat length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	for (int axis = 0; axis < 3; ++axis) {
+		v[axis] = length > 0 ? v[axis] / length : 0;
+	}
+}
+
+class OctreeBuilder {
+public:
+	OctreeBuilder(ImplicitFunc &function, const ExtractionConfig &config, const AdaptiveSettings &settings,
+		bool closeBorder, ThreadPool *pool);
+
+	Surface contour();
+
+private:
+	ImplicitFunc &function;
+	AdaptiveSettings settings;
+	bool closeBorder;
+	ThreadPool *pool;
+
+	GLint n[3];
+	std::vector<GLfloat> coords[3];
+	std::vector<OctreeNode> nodes;
+	// raw samples by lattice index, NaN where none was taken
+	std::vector<GLfloat> samples;
+
+	// quads of leaves around the crossed edges, and the crossings summed per leaf.
+	// capNormals sums the outward directions of the crossings into a closed border
+	std::vector<int> quads;
+	std::vector<GLfloat> massPoints;
+	std::vector<GLint> crossings;
+	std::vector<GLfloat> capNormals;
+
+	size_t key(GLint i, GLint j, GLint k) const {
+		return ((size_t)i * n[1] + j) * n[2] + k;
+	}
+
+	bool onBorder(GLint i, GLint j, GLint k) const {
+		return i == 0 || j == 0 || k == 0 || i == n[0] - 1 || j == n[1] - 1 || k == n[2] - 1;
+	}
+
+	// the sample the surface is taken from, closed off on the border like setBorder
+	GLfloat value(GLint i, GLint j, GLint k) const {
+		if (closeBorder && onBorder(i, j, k)) {
+			return 1000000;
+		}
+		return samples[key(i, j, k)];
+	}
+
+	bool fits(const OctreeNode &node) const {
+		return node.origin[0] + node.size < n[0] && node.origin[1] + node.size < n[1] && node.origin[2] + node.size < n[2];
+	}
+
+	int child(int node, int index) const {
+		if (node < 0 || nodes[node].leaf) {
+			return node;
+		}
+		return nodes[node].children[index];
+	}
+
+	void build();
+	void settle(OctreeNode &node);
+	void wantPoints(const OctreeNode &node, std::vector<size_t> &wanted) const;
+	void samplePoints(std::vector<size_t> &wanted);
+	bool needsSplit(const OctreeNode &node) const;
+	GLfloat allowedError(const OctreeNode &node) const;
+	void split(int node, std::vector<int> &next);
+
+	void cellProc(int node);
+	void faceProc(int node0, int node1, int axis);
+	void edgeProc(const int quad[4], int axis);
+	void processEdge(const int quad[4], int axis);
+};
+
+OctreeBuilder::OctreeBuilder(ImplicitFunc &function, const ExtractionConfig &config, const AdaptiveSettings &settings,
+	bool closeBorder, ThreadPool *pool)
+	: function(function) {
+	this->settings = settings;
+	this->settings.maxCellSize = std::max(settings.maxCellSize, 1);
+	this->closeBorder = closeBorder;
+	this->pool = pool;
+	for (int axis = 0; axis < 3; ++axis) {
+		this->n[axis] = config.resolution[axis];
+		this->coords[axis] = config.coordinates(axis);
+	}
+	this->samples.assign(config.sampleCount(), std::numeric_limits<GLfloat>::quiet_NaN());
+	build();
+}
+
+// Top down, a level of nodes at a time so that each level is sampled in one
+// batch. Nodes are bounded first; those still open at most maxCellSize wide
+// take 27 samples, at their corners, edge and face middles and centre, and
+// are split when the middle samples stray too far from the corners' blend.
+void OctreeBuilder::build() {
+	GLint cells = std::max(n[0], std::max(n[1], n[2])) - 1;
+	GLint size = 1;
+	while (size < cells) {
+		size *= 2;
+	}
+
+	OctreeNode root;
+	std::fill(root.origin, root.origin + 3, 0);
+	root.size = size;
+	nodes.push_back(root);
+
+	std::vector<int> level(1, 0);
+	while (!level.empty()) {
+		std::vector<size_t> wanted;
+		for (int node : level) {
+			settle(nodes[node]);
+			if (!nodes[node].settled && nodes[node].size <= settings.maxCellSize && fits(nodes[node])) {
+				wantPoints(nodes[node], wanted);
+			}
+		}
+		samplePoints(wanted);
+
+		std::vector<int> next;
+		for (int node : level) {
+			const OctreeNode &current = nodes[node];
+			bool leaf = current.settled || current.size == 1;
+			if (!leaf && current.size <= settings.maxCellSize && fits(current)) {
+				leaf = !needsSplit(current);
+			}
+			nodes[node].leaf = leaf;
+			if (!leaf) {
+				split(node, next);
+			}
+		}
+		level.swap(next);
+	}
+}
+
+// settle node when its bounds, over the part inside the lattice, keep it to one side
+void OctreeBuilder::settle(OctreeNode &node) {
+	if (node.size < MIN_BOUNDED_SIZE) {
+		node.settled = false;
+		return;
+	}
+
+	GLfloat lo[3], hi[3];
+	bool border = false;
+	for (int axis = 0; axis < 3; ++axis) {
+		GLint end = std::min(node.origin[axis] + node.size, n[axis] - 1);
+		lo[axis] = coords[axis][node.origin[axis]];
+		hi[axis] = coords[axis][end];
+		border = border || node.origin[axis] == 0 || end == n[axis] - 1;
+	}
+
+	GLfloat min, max;
+	function.bounds(lo, hi, min, max);
+	// the border is put outside, so a node inside there is crossed after all
+	node.settled = min >= 0 || (max < 0 && !(closeBorder && border));
+	node.leaf = node.settled;
+}
+
+void OctreeBuilder::wantPoints(const OctreeNode &node, std::vector<size_t> &wanted) const {
+	GLint step = node.size == 1 ? 1 : node.size / 2;
+	GLint steps = node.size == 1 ? 1 : 2;
+	for (GLint a = 0; a <= steps; ++a) {
+		for (GLint b = 0; b <= steps; ++b) {
+			for (GLint c = 0; c <= steps; ++c) {
+				size_t point = key(node.origin[0] + a * step, node.origin[1] + b * step, node.origin[2] + c * step);
+				if (std::isnan(samples[point])) {
+					wanted.push_back(point);
+				}
+			}
+		}
+	}
+}
+
+void OctreeBuilder::samplePoints(std::vector<size_t> &wanted) {
+	std::sort(wanted.begin(), wanted.end());
+	wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+
+	size_t count = wanted.size();
+	std::vector<GLfloat> x(count), y(count), z(count), values(count);
+	for (size_t p = 0; p < count; ++p) {
+		size_t k = wanted[p] % n[2];
+		size_t j = wanted[p] / n[2] % n[1];
+		size_t i = wanted[p] / n[2] / n[1];
+		x[p] = coords[0][i];
+		y[p] = coords[1][j];
+		z[p] = coords[2][k];
+	}
+
+	size_t batches = (count + POINT_BATCH - 1) / POINT_BATCH;
+	parallelFor(pool, batches, [&](size_t batch) {
+		size_t begin = batch * POINT_BATCH;
+		size_t end = std::min(begin + POINT_BATCH, count);
+		function.evaluatePoints(&x[begin], &y[begin], &z[begin], &values[begin], end - begin);
+	});
+
+	for (size_t p = 0; p < count; ++p) {
+		samples[wanted[p]] = values[p];
+	}
+}
+
+// The error of a node is how far its 27 samples stray from the trilinear
+// blend of its corners, over the gradient: about how many lattice cells the
+// coarse surface would be off by. A sample on the other side from the blend
+// means the node hides topology, and it is split whatever the error
+bool OctreeBuilder::needsSplit(const OctreeNode &node) const {
+	GLint half = node.size / 2;
+	GLfloat v[3][3][3];
+	bool anyInside = false, anyOutside = false;
+	GLfloat nearest = std::numeric_limits<GLfloat>::infinity();
+	for (GLint a = 0; a < 3; ++a) {
+		for (GLint b = 0; b < 3; ++b) {
+			for (GLint c = 0; c < 3; ++c) {
+				GLint i = node.origin[0] + a * half;
+				GLint j = node.origin[1] + b * half;
+				GLint k = node.origin[2] + c * half;
+				v[a][b][c] = samples[key(i, j, k)];
+				bool inside = value(i, j, k) < 0;
+				anyInside = anyInside || inside;
+				anyOutside = anyOutside || !inside;
+				nearest = std::min(nearest, std::abs(v[a][b][c]));
+			}
+		}
+	}
+
+	GLfloat error = 0;
+	bool hidden = false;
+	for (GLint a = 0; a < 3; ++a) {
+		for (GLint b = 0; b < 3; ++b) {
+			for (GLint c = 0; c < 3; ++c) {
+				GLfloat tx = a / 2.0f, ty = b / 2.0f, tz = c / 2.0f;
+				GLfloat blend = 0;
+				for (int corner = 0; corner < 8; ++corner) {
+					int ca = corner & 1, cb = (corner >> 1) & 1, cc = (corner >> 2) & 1;
+					blend += v[2 * ca][2 * cb][2 * cc] * (ca ? tx : 1 - tx) * (cb ? ty : 1 - ty) * (cc ? tz : 1 - tz);
+				}
+				error = std::max(error, std::abs(v[a][b][c] - blend));
+				hidden = hidden || (v[a][b][c] < 0) != (blend < 0);
+			}
+		}
+	}
+
+	// no surface near enough to matter
+	if (!(anyInside && anyOutside) && nearest > error) {
+		return false;
+	}
+	if (hidden) {
+		return true;
+	}
+
+	GLfloat grad[3] = { 0, 0, 0 };
+	for (GLint a = 0; a < 3; ++a) {
+		for (GLint b = 0; b < 3; ++b) {
+			grad[0] += v[2][a][b] - v[0][a][b];
+			grad[1] += v[a][2][b] - v[a][0][b];
+			grad[2] += v[a][b][2] - v[a][b][0];
+		}
+	}
+	GLfloat slope = std::sqrt(grad[0] * grad[0] + grad[1] * grad[1] + grad[2] * grad[2]) / (9 * node.size);
+	return !(slope > 0) || error / slope > allowedError(node);
+}
+
+GLfloat OctreeBuilder::allowedError(const OctreeNode &node) const {
+	if (settings.lodDistance <= 0) {
+		return settings.surfaceError;
+	}
+	GLfloat distance = 0;
+	for (int axis = 0; axis < 3; ++axis) {
+		GLint end = std::min(node.origin[axis] + node.size, n[axis] - 1);
+		GLfloat centre = (coords[axis][node.origin[axis]] + coords[axis][end]) / 2;
+		distance += (centre - settings.viewpoint[axis]) * (centre - settings.viewpoint[axis]);
+	}
+	return settings.surfaceError * std::max(1.0f, std::sqrt(distance) / settings.lodDistance);
+}
+
+void OctreeBuilder::split(int node, std::vector<int> &next) {
+	GLint half = nodes[node].size / 2;
+	for (int c = 0; c < 8; ++c) {
+		OctreeNode childNode;
+		bool inLattice = true;
+		for (int axis = 0; axis < 3; ++axis) {
+			childNode.origin[axis] = nodes[node].origin[axis] + ((c >> axis) & 1) * half;
+			inLattice = inLattice && childNode.origin[axis] < n[axis] - 1;
+		}
+		if (!inLattice) {
+			nodes[node].children[c] = -1;
+			continue;
+		}
+		childNode.size = half;
+		std::fill(childNode.children, childNode.children + 8, -1);
+		childNode.leaf = true;
+		childNode.settled = false;
+		nodes[node].children[c] = (int)nodes.size();
+		next.push_back((int)nodes.size());
+		nodes.push_back(childNode);
+	}
+}
+
+// The recursion of dual contouring: every face and edge shared by leaves is
+// reached once, from the smallest node that holds it
+void OctreeBuilder::cellProc(int node) {
+	if (node < 0 || nodes[node].leaf) {
+		return;
+	}
+	for (int c = 0; c < 8; ++c) {
+		cellProc(nodes[node].children[c]);
+	}
+
+	// the four faces across each axis
+	for (int axis = 0; axis < 3; ++axis) {
+		int b = (axis + 1) % 3, d = (axis + 2) % 3;
+		for (int q = 0; q < 4; ++q) {
+			int index = ((q & 1) << b) | ((q >> 1) << d);
+			faceProc(child(node, index), child(node, index | (1 << axis)), axis);
+		}
+	}
+
+	// the two edges along each axis through the centre
+	for (int axis = 0; axis < 3; ++axis) {
+		int p0 = (axis + 1) % 3, p1 = (axis + 2) % 3;
+		for (int h = 0; h < 2; ++h) {
+			int quad[4];
+			for (int q = 0; q < 4; ++q) {
+				quad[q] = child(node, ((q & 1) << p0) | ((q >> 1) << p1) | (h << axis));
+			}
+			edgeProc(quad, axis);
+		}
+	}
+}
+
+// the face between node0 below and node1 above along axis
+void OctreeBuilder::faceProc(int node0, int node1, int axis) {
+	if (node0 < 0 || node1 < 0 || (nodes[node0].leaf && nodes[node1].leaf)) {
+		return;
+	}
+	int b = (axis + 1) % 3, d = (axis + 2) % 3;
+	for (int q = 0; q < 4; ++q) {
+		int index = ((q & 1) << b) | ((q >> 1) << d);
+		faceProc(child(node0, index | (1 << axis)), child(node1, index), axis);
+	}
+
+	// the edges through the middle of the face, along either of its axes
+	for (int edge = 0; edge < 3; ++edge) {
+		if (edge == axis) {
+			continue;
+		}
+		int p0 = (edge + 1) % 3, p1 = (edge + 2) % 3;
+		for (int h = 0; h < 2; ++h) {
+			int quad[4];
+			for (int q = 0; q < 4; ++q) {
+				int bits[3];
+				bits[p0] = q & 1;
+				bits[p1] = q >> 1;
+				bits[edge] = h;
+				// the quadrants below the face come from node0, on its upper side
+				int side = bits[axis];
+				bits[axis] = 1 - side;
+				int index = bits[0] | (bits[1] << 1) | (bits[2] << 2);
+				quad[q] = child(side == 0 ? node0 : node1, index);
+			}
+			edgeProc(quad, edge);
+		}
+	}
+}
+
+// the edge along axis shared by quad, whose node q lies on the high side of
+// (axis + 1) % 3 when bit 0 of q is set and of (axis + 2) % 3 for bit 1
+void OctreeBuilder::edgeProc(const int quad[4], int axis) {
+	bool leaves = true;
+	for (int q = 0; q < 4; ++q) {
+		if (quad[q] < 0) {
+			return;
+		}
+		leaves = leaves && nodes[quad[q]].leaf;
+	}
+	if (leaves) {
+		processEdge(quad, axis);
+		return;
+	}
+
+	int p0 = (axis + 1) % 3, p1 = (axis + 2) % 3;
+	for (int h = 0; h < 2; ++h) {
+		int sub[4];
+		for (int q = 0; q < 4; ++q) {
+			sub[q] = child(quad[q], ((1 - (q & 1)) << p0) | ((1 - (q >> 1)) << p1) | (h << axis));
+		}
+		edgeProc(sub, axis);
+	}
+}
+
+// the edge is the side of the smallest leaf, so it is a lattice edge of every
+// leaf around it. A crossing adds a quad, wound to face out of the surface
+void OctreeBuilder::processEdge(const int quad[4], int axis) {
+	int smallest = 0;
+	for (int q = 0; q < 4; ++q) {
+		if (nodes[quad[q]].settled) {
+			return;
+		}
+		if (nodes[quad[q]].size < nodes[quad[smallest]].size) {
+			smallest = q;
+		}
+	}
+
+	const OctreeNode &node = nodes[quad[smallest]];
+	int p0 = (axis + 1) % 3, p1 = (axis + 2) % 3;
+	GLint a[3], b[3];
+	std::copy(node.origin, node.origin + 3, a);
+	a[p0] += (1 - (smallest & 1)) * node.size;
+	a[p1] += (1 - (smallest >> 1)) * node.size;
+	std::copy(a, a + 3, b);
+	b[axis] += node.size;
+
+	GLfloat aVal = value(a[0], a[1], a[2]);
+	GLfloat bVal = value(b[0], b[1], b[2]);
+	if ((aVal < 0) == (bVal < 0)) {
+		return;
+	}
+
+	GLfloat point[3] = { coords[0][a[0]], coords[1][a[1]], coords[2][a[2]] };
+	point[axis] = interpolate(coords[axis][a[axis]], aVal, coords[axis][b[axis]], bVal);
+	// a crossing into the closed border lies on its cap, which faces out of the lattice
+	GLfloat cap = 0;
+	if (closeBorder && onBorder(a[0], a[1], a[2]) != onBorder(b[0], b[1], b[2])) {
+		cap = onBorder(b[0], b[1], b[2]) ? 1.0f : -1.0f;
+	}
+	for (int q = 0; q < 4; ++q) {
+		bool repeat = false;
+		for (int r = 0; r < q; ++r) {
+			repeat = repeat || quad[r] == quad[q];
+		}
+		if (!repeat) {
+			for (int c = 0; c < 3; ++c) {
+				massPoints[3 * quad[q] + c] += point[c];
+			}
+			crossings[quad[q]]++;
+			capNormals[3 * quad[q] + axis] += cap;
+		}
+	}
+
+	// 0, 1, 3, 2 turns anticlockwise seen from the high end of axis
+	int order[4] = { quad[0], quad[1], quad[3], quad[2] };
+	if (aVal >= 0) {
+		std::reverse(order, order + 4);
+	}
+	quads.insert(quads.end(), order, order + 4);
+}
+
+// One vertex per crossed leaf, at the mean of its edge crossings, and two
+// triangles per quad. Normals follow the field, except on the caps of a closed
+// border, where they face out of the lattice as extractSurface's do
+Surface OctreeBuilder::contour() {
+	massPoints.assign(3 * nodes.size(), 0);
+	crossings.assign(nodes.size(), 0);
+	capNormals.assign(3 * nodes.size(), 0);
+	cellProc(0);
+
+	Surface surface;
+	std::vector<GLint> vertexOf(nodes.size(), -1);
+	std::vector<int> leafOf;
+	for (int node : quads) {
+		if (vertexOf[node] >= 0) {
+			continue;
+		}
+		vertexOf[node] = (GLint)surface.vertexCount();
+		leafOf.push_back(node);
+		for (int c = 0; c < 3; ++c) {
+			surface.vertices.push_back(massPoints[3 * node + c] / crossings[node]);
+		}
+	}
+
+	surface.normals.resize(surface.vertices.size());
+	size_t count = surface.vertexCount();
+	size_t batches = (count + POINT_BATCH - 1) / POINT_BATCH;
+	parallelFor(pool, batches, [&](size_t batch) {
+		size_t end = std::min((batch + 1) * POINT_BATCH, count);
+		for (size_t v = batch * POINT_BATCH; v < end; ++v) {
+			const GLfloat *cap = &capNormals[3 * leafOf[v]];
+			GLfloat *normal = &surface.normals[3 * v];
+			if (cap[0] != 0 || cap[1] != 0 || cap[2] != 0) {
+				std::copy(cap, cap + 3, normal);
+			}
+			else {
+				const GLfloat *point = &surface.vertices[3 * v];
+				function.gradient(point[0], point[1], point[2], normal);
+			}
+			normalize(normal);
+		}
+	});
+
+	// quads around an edge where leaves of different sizes meet repeat a
+	// leaf, and lose the triangle that would be degenerate
+	for (size_t q = 0; q < quads.size(); q += 4) {
+		GLuint v[4];
+		for (int c = 0; c < 4; ++c) {
+			v[c] = (GLuint)vertexOf[quads[q + c]];
+		}
+		if (v[0] != v[1] && v[1] != v[2] && v[2] != v[0]) {
+			surface.indices.insert(surface.indices.end(), { v[0], v[1], v[2] });
+		}
+		if (v[0] != v[2] && v[2] != v[3] && v[3] != v[0]) {
+			surface.indices.insert(surface.indices.end(), { v[0], v[2], v[3] });
+		}
+	}
+	return surface;
+}
+
+Surface adaptiveMesh(std::shared_ptr<ImplicitFunc> function, const ExtractionConfig &config,
+	const AdaptiveSettings &settings, ThreadPool *pool) {
+	if (config.resolution[0] < 2 || config.resolution[1] < 2 || config.resolution[2] < 2) {
+		return Surface();
+	}
+	OctreeBuilder octree(*function, config, settings, config.closeBorder, pool);
+	return octree.contour();
+}
+
+Surface adaptiveUnion(std::shared_ptr<ImplicitFunc> funcA, std::shared_ptr<ImplicitFunc> funcB, const ExtractionConfig &config,
+	const AdaptiveSettings &settings, ThreadPool *pool) {
+	if (config.resolution[0] < 2 || config.resolution[1] < 2 || config.resolution[2] < 2) {
+		return Surface();
+	}
+	ClippedFunc clipped(funcA, funcB);
+	OctreeBuilder octree(clipped, config, settings, false, pool);
+	return octree.contour();
+}
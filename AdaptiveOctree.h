@@ -0,0 +1,39 @@
+#include <memory>
+#include "ImplicitFunc.h"
+#include "Surface.h"
+#include "ExtractionConfig.h"
+
+#ifndef ADAPTIVEOCTREE_H
+#define ADAPTIVEOCTREE_H
+
+class ThreadPool;
+
+// How far adaptiveMesh may coarsen the lattice of an ExtractionConfig.
+// Cells start maxCellSize lattice cells wide, a power of two, and are split
+// while the field inside them strays more than surfaceError lattice cells
+// from the trilinear blend of their corners. With lodDistance > 0 the allowed
+// error also grows with the distance from viewpoint, in lodDistance steps.
+struct AdaptiveSettings {
+	GLint maxCellSize;
+	GLfloat surfaceError;
+	GLfloat viewpoint[3];
+	GLfloat lodDistance;
+
+	AdaptiveSettings();
+};
+
+// Surface of function over an octree of cells 1 to maxCellSize lattice cells
+// wide. It is contoured dually: one vertex per leaf cell the surface passes
+// through, and a quad joining the leaves around each crossed edge, found by
+// the cell, face and edge recursion of dual contouring. Leaves of different
+// sizes share those quads, so the mesh stays closed where the level changes.
+// Cells that the function's bounds settle are not sampled. As with genMesh,
+// the lattice faces close the surface off.
+Surface adaptiveMesh(std::shared_ptr<ImplicitFunc> function, const ExtractionConfig &config,
+	const AdaptiveSettings &settings, ThreadPool *pool = nullptr);
+
+// the same for the surface of funcA clipped to the inside of the container funcB
+Surface adaptiveUnion(std::shared_ptr<ImplicitFunc> funcA, std::shared_ptr<ImplicitFunc> funcB, const ExtractionConfig &config,
+	const AdaptiveSettings &settings, ThreadPool *pool = nullptr);
+
+#endif
@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <vector>
+#include "AnimatedFunc.h"
+
+AnimatedFunc::AnimatedFunc(GLfloat iso, GLfloat amin, GLfloat amax, GLfloat bmin, GLfloat bmax) {
+	this->iso = iso;
+	this->amin = amin;
+	this->amax = amax;
+	this->bmin = bmin;
+	this->bmax = bmax;
+	this->time = 0.0;
+	this->x_off = 0.0;
+	this->y_off = 0.0;
+	this->z_off = 0.0;
+	this->sn = Simplex();
+	this->octaves = 1;
+	this->persistence = 0.5;
+}
+
+bool AnimatedFunc::isInside(GLfloat x, GLfloat y, GLfloat z) {
+	return function(x, y, z) < 0;
+}
+
+GLfloat AnimatedFunc::function(GLfloat x, GLfloat y, GLfloat z) {
+	double px = map(x) + x_off;
+	double py = map(y) + y_off;
+	double pz = map(z) + z_off;
+
+	double total = 0;
+	double frequency = 1;
+	double amplitude = 1;
+	double maxValue = 0;
+	for (int i = 0; i < octaves; i++) {
+		total += sn.noise(px * frequency, py * frequency, pz * frequency, time * frequency) * amplitude;
+		maxValue += amplitude;
+		amplitude *= persistence;
+		frequency *= 2;
+	}
+	return total / maxValue - iso;
+}
+
+void AnimatedFunc::evaluateBlock(const GLfloat *xs, size_t nx, const GLfloat *ys, size_t ny,
+	const GLfloat *zs, size_t nz, GLfloat *out) {
+	// map each axis once instead of once per sample
+	std::vector<double> mx(nx), my(ny), mz(nz);
+	for (size_t i = 0; i < nx; ++i) {
+		mx[i] = map(xs[i]) + x_off;
+	}
+	for (size_t j = 0; j < ny; ++j) {
+		my[j] = map(ys[j]) + y_off;
+	}
+	for (size_t k = 0; k < nz; ++k) {
+		mz[k] = map(zs[k]) + z_off;
+	}
+
+	// one batch call per row and octave, summed in the same order as function
+	std::vector<double> px(nz), py(nz), pz(nz), value(nz), total(nz);
+	for (size_t i = 0; i < nx; ++i) {
+		for (size_t j = 0; j < ny; ++j) {
+			std::fill(total.begin(), total.end(), 0.0);
+			double frequency = 1;
+			double amplitude = 1;
+			double maxValue = 0;
+			for (int o = 0; o < octaves; o++) {
+				for (size_t k = 0; k < nz; ++k) {
+					px[k] = mx[i] * frequency;
+					py[k] = my[j] * frequency;
+					pz[k] = mz[k] * frequency;
+				}
+				sn.noise(&px[0], &py[0], &pz[0], time * frequency, &value[0], nz);
+				for (size_t k = 0; k < nz; ++k) {
+					total[k] += value[k] * amplitude;
+				}
+				maxValue += amplitude;
+				amplitude *= persistence;
+				frequency *= 2;
+			}
+			for (size_t k = 0; k < nz; ++k) {
+				*out++ = total[k] / maxValue - iso;
+			}
+		}
+	}
+}
+
+void AnimatedFunc::setTime(double time) {
+	this->time = time;
+}
+
+double AnimatedFunc::getTime() const {
+	return time;
+}
+
+void AnimatedFunc::setOctaves(int octaves, GLfloat persistence) {
+	this->octaves = octaves < 1 ? 1 : octaves;
+	this->persistence = persistence;
+}
+
+int AnimatedFunc::getOctaves() const {
+	return octaves;
+}
+
+GLfloat AnimatedFunc::map(GLfloat val) {
+	return bmin + (bmax - bmin) * (val - amin) / (amax - amin);
+}
+
+GLfloat AnimatedFunc::offsetScale() const {
+	return (amax - amin) / (bmax - bmin);
+}
+
+void AnimatedFunc::incXoff(float inc) {
+	this->x_off += inc;
+}
+
+void AnimatedFunc::incYoff(float inc) {
+	this->y_off += inc;
+}
+
+void AnimatedFunc::incZoff(float inc) {
+	this->z_off += inc;
+}
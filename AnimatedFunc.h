@@ -0,0 +1,53 @@
+#include "ImplicitFunc.h"
+#include "Simplex.h"
+
+#ifndef ANIMATEDFUNC_H
+#define ANIMATEDFUNC_H
+
+// Noise field that morphs over time: 4D simplex noise sampled at (x, y, z, t).
+// Advancing t changes the shape in place, where scrolling an offset through
+// 3D noise slides the surface along an axis.
+class AnimatedFunc : public ImplicitFunc {
+private:
+	GLfloat iso;
+	double time;
+
+	GLfloat x_off;
+	GLfloat y_off;
+	GLfloat z_off;
+
+	Simplex sn;
+	int octaves;
+	GLfloat persistence;
+
+	GLfloat map(GLfloat val);
+
+public:
+	GLfloat amin;
+	GLfloat amax;
+	GLfloat bmin;
+	GLfloat bmax;
+
+	AnimatedFunc(GLfloat iso, GLfloat amin, GLfloat amax, GLfloat bmin, GLfloat bmax);
+	bool isInside(GLfloat x, GLfloat y, GLfloat z);
+	GLfloat function(GLfloat x, GLfloat y, GLfloat z);
+	void evaluateBlock(const GLfloat *xs, size_t nx, const GLfloat *ys, size_t ny,
+		const GLfloat *zs, size_t nz, GLfloat *out);
+
+	// t is in noise units: 1 changes the field about as much as moving one lattice cell
+	void setTime(double time);
+	double getTime() const;
+
+	// each octave doubles the frequency in time as well as space
+	void setOctaves(int octaves, GLfloat persistence);
+	int getOctaves() const;
+
+	// the domain [amin, amax] covers [bmin, bmax] of noise
+	GLfloat offsetScale() const;
+
+	void incXoff(float inc);
+	void incYoff(float inc);
+	void incZoff(float inc);
+};
+
+#endif
@@ -0,0 +1,298 @@
+#include "ChunkManager.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <utility>
+
+#include "MarchingCubes.h"
+
+// bytes charged to every resident chunk on top of its buffers, so that
+// chunks without triangles still age out of the cache
+static const size_t CHUNK_OVERHEAD = 256;
+
+size_t ChunkManager::KeyHash::operator()(const Key &key) const {
+	size_t hash = (size_t)(unsigned)key.x;
+	hash = hash * 73856093u ^ (size_t)(unsigned)key.y;
+	hash = hash * 19349663u ^ (size_t)(unsigned)key.z;
+	return hash;
+}
+
+ChunkManager::ChunkManager(std::shared_ptr<ImplicitFunc> function, GLfloat chunkSize, GLint resolution, GLint viewRadius,
+	size_t memoryBudget, int workers, bool reorder) : bytes(0), frame(0), queuedFrame(0), missesBefore(0), missesAfter(0),
+	reorderedTriangles(0), reorderedVertices(0), stopping(false) {
+	this->function = function;
+	centre[0] = centre[1] = centre[2] = 0;
+	this->chunkSize = chunkSize;
+	this->resolution = std::max(resolution, 2);
+	this->viewRadius = std::max(viewRadius, 0);
+	this->memoryBudget = memoryBudget;
+	this->reorder = reorder;
+
+	if (workers <= 0) {
+		workers = std::max((int)std::thread::hardware_concurrency() - 1, 1);
+	}
+	for (int n = 0; n < workers; ++n) {
+		this->workers.push_back(std::thread(&ChunkManager::workerLoop, this));
+	}
+}
+
+ChunkManager::~ChunkManager() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (size_t n = 0; n < workers.size(); ++n) {
+		workers[n].join();
+	}
+
+	for (auto &entry : resident) {
+		if (entry.second.indexCount > 0) {
+			glDeleteVertexArrays(1, &entry.second.VAO);
+			glDeleteBuffers(1, &entry.second.VBO);
+			glDeleteBuffers(1, &entry.second.EBO);
+		}
+	}
+}
+
+void ChunkManager::update(const GLfloat camera[3]) {
+	++frame;
+	for (int axis = 0; axis < 3; ++axis) {
+		centre[axis] = (GLint)std::floor(camera[axis] / chunkSize);
+	}
+
+	// the chunks in view that still have to be meshed, with their squared distance in chunks
+	std::vector<std::pair<GLint, Key>> wanted;
+	GLint r = viewRadius;
+	for (GLint dx = -r; dx <= r; ++dx) {
+		for (GLint dy = -r; dy <= r; ++dy) {
+			for (GLint dz = -r; dz <= r; ++dz) {
+				GLint distance = dx * dx + dy * dy + dz * dz;
+				if (distance > r * r) {
+					continue;
+				}
+				Key key = { centre[0] + dx, centre[1] + dy, centre[2] + dz };
+				auto found = resident.find(key);
+				if (found != resident.end()) {
+					found->second.lastSeen = frame;
+				}
+				else {
+					wanted.push_back(std::make_pair(distance, key));
+				}
+			}
+		}
+	}
+
+	// farthest first, as the workers take from the back
+	std::stable_sort(wanted.begin(), wanted.end(), [](const std::pair<GLint, Key> &a, const std::pair<GLint, Key> &b) {
+		return a.first > b.first;
+	});
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.clear();
+		queuedFrame = frame;
+		for (size_t n = 0; n < wanted.size(); ++n) {
+			if (busy.find(wanted[n].second) == busy.end()) {
+				queue.push_back(wanted[n].second);
+			}
+		}
+	}
+	wake.notify_all();
+}
+
+int ChunkManager::upload(int maxUploads) {
+	std::vector<Meshed> ready;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		size_t count = std::min(finished.size(), (size_t)std::max(maxUploads, 0));
+		for (size_t n = 0; n < count; ++n) {
+			busy.erase(finished[n].key);
+		}
+		std::move(finished.begin(), finished.begin() + count, std::back_inserter(ready));
+		finished.erase(finished.begin(), finished.begin() + count);
+	}
+
+	for (size_t n = 0; n < ready.size(); ++n) {
+		Mesh &mesh = *ready[n].mesh;
+		Resident chunk;
+		chunk.VAO = chunk.VBO = chunk.EBO = 0;
+		chunk.indexCount = (GLsizei)mesh.vIndices.size();
+		chunk.bytes = CHUNK_OVERHEAD;
+		// a chunk that left view while it was meshed ages from when it was queued
+		chunk.lastSeen = inView(ready[n].key) ? frame : ready[n].queued;
+		if (chunk.indexCount > 0) {
+			glGenVertexArrays(1, &chunk.VAO);
+			glGenBuffers(1, &chunk.VBO);
+			glGenBuffers(1, &chunk.EBO);
+			glBindVertexArray(chunk.VAO);
+			glBindBuffer(GL_ARRAY_BUFFER, chunk.VBO);
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, chunk.EBO);
+			// unbinds the vertex array once its attributes are set
+			mesh.bindBuffer();
+			// three floats of position, colour and normal per vertex
+			chunk.bytes += 3 * mesh.vPositions.size() * sizeof(GLfloat) + mesh.vIndices.size() * sizeof(GLuint);
+		}
+		resident[ready[n].key] = chunk;
+		bytes += chunk.bytes;
+	}
+
+	evict();
+	return (int)ready.size();
+}
+
+// free the chunks least recently in view until the rest fit the budget.
+// Chunks in view now are kept even when they alone go over it
+void ChunkManager::evict() {
+	if (bytes <= memoryBudget) {
+		return;
+	}
+
+	std::vector<std::pair<unsigned, Key>> stale;
+	for (auto &entry : resident) {
+		if (entry.second.lastSeen < frame) {
+			stale.push_back(std::make_pair(entry.second.lastSeen, entry.first));
+		}
+	}
+	std::sort(stale.begin(), stale.end(), [](const std::pair<unsigned, Key> &a, const std::pair<unsigned, Key> &b) {
+		return a.first < b.first;
+	});
+
+	for (size_t n = 0; n < stale.size() && bytes > memoryBudget; ++n) {
+		Resident &chunk = resident[stale[n].second];
+		if (chunk.indexCount > 0) {
+			glDeleteVertexArrays(1, &chunk.VAO);
+			glDeleteBuffers(1, &chunk.VBO);
+			glDeleteBuffers(1, &chunk.EBO);
+		}
+		bytes -= chunk.bytes;
+		resident.erase(stale[n].second);
+	}
+}
+
+void ChunkManager::draw() const {
+	for (auto &entry : resident) {
+		if (entry.second.indexCount > 0) {
+			glBindVertexArray(entry.second.VAO);
+			glDrawElements(GL_TRIANGLES, entry.second.indexCount, GL_UNSIGNED_INT, (GLvoid *)0);
+		}
+	}
+	glBindVertexArray(0);
+}
+
+size_t ChunkManager::residentCount() const {
+	return resident.size();
+}
+
+size_t ChunkManager::residentBytes() const {
+	return bytes;
+}
+
+size_t ChunkManager::queuedCount() const {
+	std::lock_guard<std::mutex> lock(mutex);
+	return queue.size();
+}
+
+// whether key was within viewRadius chunks of the camera at the last update
+bool ChunkManager::inView(const Key &key) const {
+	GLint dx = key.x - centre[0];
+	GLint dy = key.y - centre[1];
+	GLint dz = key.z - centre[2];
+	return dx * dx + dy * dy + dz * dz <= viewRadius * viewRadius;
+}
+
+void ChunkManager::drawOrderStats(CacheStats &before, CacheStats &after) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	before.acmr = before.atvr = after.acmr = after.atvr = 0;
+	if (reorderedTriangles > 0) {
+		before.acmr = missesBefore / reorderedTriangles;
+		before.atvr = missesBefore / reorderedVertices;
+		after.acmr = missesAfter / reorderedTriangles;
+		after.atvr = missesAfter / reorderedVertices;
+	}
+}
+
+void ChunkManager::workerLoop() {
+	for (;;) {
+		Key key;
+		unsigned queued;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this] { return stopping || !queue.empty(); });
+			if (stopping) {
+				return;
+			}
+			key = queue.back();
+			queue.pop_back();
+			queued = queuedFrame;
+			busy.insert(key);
+		}
+
+		CacheStats before = { 0, 0 }, after = { 0, 0 };
+		size_t triangles, vertices;
+		std::unique_ptr<Mesh> mesh = meshChunk(key, before, after, triangles, vertices);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (reorder && triangles > 0) {
+			missesBefore += before.acmr * triangles;
+			missesAfter += after.acmr * triangles;
+			reorderedTriangles += triangles;
+			reorderedVertices += vertices;
+		}
+		Meshed done;
+		done.key = key;
+		done.queued = queued;
+		done.mesh = std::move(mesh);
+		finished.push_back(std::move(done));
+	}
+}
+
+// genMesh over the chunk on this thread alone, interleaved ready for upload and in draw order
+// when reordering, with the vertex cache's use before and after that.
+// Neighbours share their face samples, so the open faces meet exactly. Each side only has
+// one-sided differences for the normals there, so those come from the field's gradient
+std::unique_ptr<Mesh> ChunkManager::meshChunk(const Key &key, CacheStats &before, CacheStats &after, size_t &triangles,
+	size_t &vertices) const {
+	GLint origin[3] = { key.x, key.y, key.z };
+	GLfloat minCorner[3], maxCorner[3];
+	GLint samples[3] = { resolution, resolution, resolution };
+	for (int axis = 0; axis < 3; ++axis) {
+		minCorner[axis] = origin[axis] * chunkSize;
+		maxCorner[axis] = (origin[axis] + 1) * chunkSize;
+	}
+	ExtractionConfig config(minCorner, maxCorner, samples);
+	config.closeBorder = false;
+
+	Surface surface = genMesh(function, config);
+	for (size_t v = 0; v < surface.vertexCount(); ++v) {
+		const GLfloat *point = &surface.vertices[3 * v];
+		bool onFace = false;
+		for (int axis = 0; axis < 3; ++axis) {
+			onFace = onFace || point[axis] == minCorner[axis] || point[axis] == maxCorner[axis];
+		}
+		if (!onFace) {
+			continue;
+		}
+		GLfloat *normal = &surface.normals[3 * v];
+		function->gradient(point[0], point[1], point[2], normal);
+		GLfloat length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (length > 0) {
+			for (int axis = 0; axis < 3; ++axis) {
+				normal[axis] /= length;
+			}
+		}
+	}
+	triangles = surface.triangleCount();
+	vertices = surface.vertexCount();
+	if (reorder) {
+		before = simulateVertexCache(surface);
+		optimizeDrawOrder(surface);
+		after = simulateVertexCache(surface);
+	}
+	std::unique_ptr<Mesh> mesh(new Mesh(0.4f, 0.4f, 0.4f));
+	mesh->setVPositions(surface.vertices);
+	mesh->setVIndices(surface.indices);
+	mesh->setVNormals(surface.normals);
+	mesh->genBuffer();
+	return mesh;
+}
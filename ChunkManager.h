@@ -0,0 +1,116 @@
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "ImplicitFunc.h"
+#include "DrawOrder.h"
+#include "mesh.h"
+
+#ifndef CHUNKMANAGER_H
+#define CHUNKMANAGER_H
+
+// Surface of an unbounded field streamed as cubic chunks around a camera.
+// Chunk (x, y, z) spans [x, x + 1] * chunkSize along x, and the same along y
+// and z. Chunks within viewRadius chunks of the camera are meshed by genMesh
+// on worker threads, with their faces left open so that neighbours join up.
+// They are uploaded to a vertex array each on the GL thread, a few per frame.
+// When their GPU bytes pass memoryBudget, the chunks least recently in view
+// are freed first.
+class ChunkManager {
+public:
+	// resolution samples per chunk along each axis; workers <= 0 leaves one hardware thread for rendering.
+	// reorder puts each chunk in draw order by optimizeDrawOrder before upload
+	ChunkManager(std::shared_ptr<ImplicitFunc> function, GLfloat chunkSize, GLint resolution, GLint viewRadius,
+		size_t memoryBudget, int workers, bool reorder);
+	// frees the vertex arrays, so the GL context must still be current
+	~ChunkManager();
+
+	// queue the chunks in view of camera that are not resident yet, nearest first.
+	// Queued chunks that have gone out of view are dropped
+	void update(const GLfloat camera[3]);
+
+	// upload at most maxUploads meshed chunks and free chunks over the budget.
+	// Returns the number uploaded
+	int upload(int maxUploads);
+
+	// draw every resident chunk with the shader in use
+	void draw() const;
+
+	size_t residentCount() const;
+	size_t residentBytes() const;
+	size_t queuedCount() const;
+
+	// vertex cache use of every chunk reordered so far, taken together,
+	// before and after reordering. Both are 0 until one has been
+	void drawOrderStats(CacheStats &before, CacheStats &after) const;
+
+private:
+	struct Key {
+		GLint x, y, z;
+
+		bool operator==(const Key &key) const {
+			return x == key.x && y == key.y && z == key.z;
+		}
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key &key) const;
+	};
+
+	// a chunk on the GPU; one without triangles has no vertex array
+	struct Resident {
+		GLuint VAO, VBO, EBO;
+		GLsizei indexCount;
+		size_t bytes;
+		unsigned lastSeen;
+	};
+
+	// queued is the frame the chunk was last queued in view
+	struct Meshed {
+		Key key;
+		unsigned queued;
+		std::unique_ptr<Mesh> mesh;
+	};
+
+	std::shared_ptr<ImplicitFunc> function;
+	GLfloat chunkSize;
+	GLint resolution;
+	GLint viewRadius;
+	size_t memoryBudget;
+	bool reorder;
+
+	// touched by the GL thread only
+	std::unordered_map<Key, Resident, KeyHash> resident;
+	size_t bytes;
+	unsigned frame;
+	GLint centre[3];
+
+	// shared with the workers. queue holds the nearest chunk last; busy has
+	// the chunks being meshed or waiting in finished for upload
+	mutable std::mutex mutex;
+	std::condition_variable wake;
+	std::vector<Key> queue;
+	unsigned queuedFrame;
+	std::unordered_set<Key, KeyHash> busy;
+	std::vector<Meshed> finished;
+	// cache misses of the reordered chunks before and after, over their triangles and vertices
+	double missesBefore, missesAfter;
+	size_t reorderedTriangles, reorderedVertices;
+	bool stopping;
+	std::vector<std::thread> workers;
+
+	ChunkManager(const ChunkManager &manager);
+	ChunkManager &operator=(const ChunkManager &manager);
+
+	bool inView(const Key &key) const;
+	void workerLoop();
+	std::unique_ptr<Mesh> meshChunk(const Key &key, CacheStats &before, CacheStats &after, size_t &triangles,
+		size_t &vertices) const;
+	void evict();
+};
+
+#endif
@@ -0,0 +1,526 @@
+#include "Decimation.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// a collapse may turn a triangle no further than this from its old normal, as a cosine
+static const double MIN_NORMAL_COS = 0.2;
+// the least point of a quadric is solved for only when its determinant is at
+// least this share of its trace cubed; flatter quadrics have no single least point
+static const double MIN_DETERMINANT = 1e-6;
+
+DecimationSettings::DecimationSettings() {
+	this->targetTriangles = 0;
+	this->maxError = 0.001f;
+}
+
+static void cross(const double a[3], const double b[3], double out[3]) {
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static double dot(const double a[3], const double b[3]) {
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// the sum over planes n . p + d = 0 of weight * (n . p + d)^2, as the upper
+// triangle of its symmetric 4x4 matrix: xx, xy, xz, xd, yy, yz, yd, zz, zd, dd
+struct Quadric {
+	double q[10];
+	double weight;
+
+	Quadric() : weight(0) {
+		std::fill(q, q + 10, 0.0);
+	}
+
+	void addPlane(const double n[3], double d, double w) {
+		q[0] += w * n[0] * n[0];
+		q[1] += w * n[0] * n[1];
+		q[2] += w * n[0] * n[2];
+		q[3] += w * n[0] * d;
+		q[4] += w * n[1] * n[1];
+		q[5] += w * n[1] * n[2];
+		q[6] += w * n[1] * d;
+		q[7] += w * n[2] * n[2];
+		q[8] += w * n[2] * d;
+		q[9] += w * d * d;
+		weight += w;
+	}
+
+	void add(const Quadric &other) {
+		for (int n = 0; n < 10; ++n) {
+			q[n] += other.q[n];
+		}
+		weight += other.weight;
+	}
+
+	// mean squared distance of p to the planes
+	double error(const double p[3]) const {
+		if (weight <= 0) {
+			return 0;
+		}
+		double x = p[0], y = p[1], z = p[2];
+		double sum = q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+			+ q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+			+ q[7] * z * z + 2 * q[8] * z + q[9];
+		return std::max(sum / weight, 0.0);
+	}
+
+	// the point of least error, by Cramer's rule; false when there is no single one
+	bool minimum(double p[3]) const {
+		double a00 = q[0], a01 = q[1], a02 = q[2], a11 = q[4], a12 = q[5], a22 = q[7];
+		double b0 = -q[3], b1 = -q[6], b2 = -q[8];
+		double c00 = a11 * a22 - a12 * a12;
+		double c01 = a02 * a12 - a01 * a22;
+		double c02 = a01 * a12 - a02 * a11;
+		double det = a00 * c00 + a01 * c01 + a02 * c02;
+		double trace = a00 + a11 + a22;
+		if (!(det > MIN_DETERMINANT * trace * trace * trace)) {
+			return false;
+		}
+		double c11 = a00 * a22 - a02 * a02;
+		double c12 = a01 * a02 - a00 * a12;
+		double c22 = a00 * a11 - a01 * a01;
+		p[0] = (c00 * b0 + c01 * b1 + c02 * b2) / det;
+		p[1] = (c01 * b0 + c11 * b1 + c12 * b2) / det;
+		p[2] = (c02 * b0 + c12 * b1 + c22 * b2) / det;
+		return true;
+	}
+};
+
+// edge from-to merged into to at position, costing cost
+struct Collapse {
+	double cost;
+	GLuint from, to;
+	double position[3];
+};
+
+// an edge waiting in the heap. The stamps are those of its ends when it was
+// queued; a collapse at either end since makes it stale
+struct QueuedEdge {
+	float cost;
+	GLuint a, b;
+	unsigned aStamp, bStamp;
+};
+
+// the cheapest edge first out of a std heap
+struct Costlier {
+	bool operator()(const QueuedEdge &x, const QueuedEdge &y) const {
+		return x.cost > y.cost;
+	}
+};
+
+class Decimator {
+public:
+	Decimator(const Surface &surface);
+
+	void run(const DecimationSettings &settings);
+	Surface result() const;
+
+private:
+	std::vector<double> positions;
+	std::vector<GLfloat> normals;
+	std::vector<GLuint> triangles;
+	std::vector<bool> triangleAlive;
+	std::vector<bool> vertexAlive;
+	std::vector<bool> locked;
+	std::vector<unsigned> stamps;
+	// the live triangles around each vertex
+	std::vector<std::vector<GLuint>> fans;
+	std::vector<Quadric> quadrics;
+	std::vector<QueuedEdge> heap;
+	size_t liveTriangles;
+
+	// reused by the topology checks
+	std::vector<GLuint> neighboursFrom, neighboursTo;
+
+	void lockNonManifold();
+	void plan(GLuint a, GLuint b, Collapse &collapse) const;
+	void queueEdge(GLuint a, GLuint b);
+	void neighbours(GLuint v, std::vector<GLuint> &out) const;
+	bool canCollapse(const Collapse &collapse);
+	bool keepsOrientation(GLuint moved, GLuint other, const double position[3]) const;
+	void collapse(const Collapse &collapse);
+};
+
+Decimator::Decimator(const Surface &surface) : liveTriangles(0) {
+	size_t vertexCount = surface.vertexCount();
+	size_t triangleCount = surface.triangleCount();
+	positions.assign(surface.vertices.begin(), surface.vertices.end());
+	normals = surface.normals;
+	normals.resize(3 * vertexCount, 0.0f);
+	triangles = surface.indices;
+	triangleAlive.assign(triangleCount, false);
+	vertexAlive.assign(vertexCount, true);
+	locked.assign(vertexCount, false);
+	stamps.assign(vertexCount, 0);
+	fans.resize(vertexCount);
+	quadrics.resize(vertexCount);
+
+	for (size_t t = 0; t < triangleCount; ++t) {
+		const GLuint *v = &triangles[3 * t];
+		// triangles repeating a vertex cover nothing
+		if (v[0] == v[1] || v[1] == v[2] || v[2] == v[0]) {
+			continue;
+		}
+		triangleAlive[t] = true;
+		++liveTriangles;
+
+		const double *p0 = &positions[3 * v[0]];
+		const double *p1 = &positions[3 * v[1]];
+		const double *p2 = &positions[3 * v[2]];
+		double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		double n[3];
+		cross(e1, e2, n);
+		double length = std::sqrt(dot(n, n));
+		for (int corner = 0; corner < 3; ++corner) {
+			fans[v[corner]].push_back((GLuint)t);
+		}
+		if (length <= 0) {
+			continue;
+		}
+		for (int axis = 0; axis < 3; ++axis) {
+			n[axis] /= length;
+		}
+		// weighted by area
+		double d = -dot(n, p0);
+		for (int corner = 0; corner < 3; ++corner) {
+			quadrics[v[corner]].addPlane(n, d, 0.5 * length);
+		}
+	}
+
+	lockNonManifold();
+
+	// every edge once, from the triangle that runs along it upwards
+	for (size_t t = 0; t < triangleCount; ++t) {
+		if (!triangleAlive[t]) {
+			continue;
+		}
+		for (int corner = 0; corner < 3; ++corner) {
+			GLuint a = triangles[3 * t + corner];
+			GLuint b = triangles[3 * t + (corner + 1) % 3];
+			if (a < b) {
+				queueEdge(a, b);
+			}
+		}
+	}
+}
+
+// lock the vertices whose triangles are not one consistently wound fan closed
+// all the way round: those on open edges, on edges of more than two triangles,
+// and those where fans meet at a point
+void Decimator::lockNonManifold() {
+	std::vector<GLuint> after, before, sorted;
+	for (size_t v = 0; v < fans.size(); ++v) {
+		const std::vector<GLuint> &fan = fans[v];
+		if (fan.empty()) {
+			continue;
+		}
+		// each triangle leads round v from the corner after it to the one before it
+		after.clear();
+		before.clear();
+		for (size_t n = 0; n < fan.size(); ++n) {
+			const GLuint *t = &triangles[3 * fan[n]];
+			int corner = t[0] == v ? 0 : (t[1] == v ? 1 : 2);
+			after.push_back(t[(corner + 1) % 3]);
+			before.push_back(t[(corner + 2) % 3]);
+		}
+
+		sorted = after;
+		std::sort(sorted.begin(), sorted.end());
+		bool manifold = std::adjacent_find(sorted.begin(), sorted.end()) == sorted.end();
+
+		// walk the fan from its first triangle until it closes
+		size_t steps = 0;
+		GLuint current = before[0];
+		while (manifold && steps < fan.size()) {
+			size_t next = std::find(after.begin(), after.end(), current) - after.begin();
+			if (next == after.size()) {
+				manifold = false;
+				break;
+			}
+			current = before[next];
+			++steps;
+			if (current == before[0]) {
+				break;
+			}
+		}
+		locked[v] = !manifold || steps != fan.size();
+	}
+}
+
+// the collapse of edge a-b at the least error its ends allow. A locked end
+// stays where it is, so at most one of them may be locked
+void Decimator::plan(GLuint a, GLuint b, Collapse &collapse) const {
+	if (locked[a]) {
+		std::swap(a, b);
+	}
+
+	collapse.from = a;
+	collapse.to = b;
+	Quadric quadric = quadrics[a];
+	quadric.add(quadrics[b]);
+
+	const double *pa = &positions[3 * a];
+	const double *pb = &positions[3 * b];
+	double middle[3] = { (pa[0] + pb[0]) / 2, (pa[1] + pb[1]) / 2, (pa[2] + pb[2]) / 2 };
+	double edge[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+	bool placed = false;
+	if (locked[b]) {
+		std::copy(pb, pb + 3, collapse.position);
+		placed = true;
+	}
+	else if (quadric.minimum(collapse.position)) {
+		// a least point far off the edge comes from a nearly flat quadric
+		double offset[3] = { collapse.position[0] - middle[0], collapse.position[1] - middle[1], collapse.position[2] - middle[2] };
+		placed = dot(offset, offset) <= dot(edge, edge);
+	}
+	if (!placed) {
+		// the best of the two ends and the middle
+		const double *candidates[3] = { pa, pb, middle };
+		double best = -1;
+		for (int n = 0; n < 3; ++n) {
+			double error = quadric.error(candidates[n]);
+			if (best < 0 || error < best) {
+				best = error;
+				std::copy(candidates[n], candidates[n] + 3, collapse.position);
+			}
+		}
+	}
+	collapse.cost = quadric.error(collapse.position);
+}
+
+// an edge between two locked ends is never collapsed
+void Decimator::queueEdge(GLuint a, GLuint b) {
+	if (locked[a] && locked[b]) {
+		return;
+	}
+	Collapse collapse;
+	plan(a, b, collapse);
+	QueuedEdge edge = { (float)collapse.cost, a, b, stamps[a], stamps[b] };
+	heap.push_back(edge);
+	std::push_heap(heap.begin(), heap.end(), Costlier());
+}
+
+// the vertices sharing a triangle with v, sorted
+void Decimator::neighbours(GLuint v, std::vector<GLuint> &out) const {
+	out.clear();
+	for (size_t n = 0; n < fans[v].size(); ++n) {
+		const GLuint *t = &triangles[3 * fans[v][n]];
+		for (int corner = 0; corner < 3; ++corner) {
+			if (t[corner] != v) {
+				out.push_back(t[corner]);
+			}
+		}
+	}
+	std::sort(out.begin(), out.end());
+	out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+bool Decimator::canCollapse(const Collapse &collapse) {
+	GLuint from = collapse.from;
+	GLuint to = collapse.to;
+
+	// the edge must lie between two triangles, and its ends share no other
+	// neighbour than the two corners opposite it; otherwise the collapse
+	// would pinch the surface or glue two sheets together
+	GLuint opposite[2];
+	int shared = 0;
+	for (size_t n = 0; n < fans[from].size(); ++n) {
+		const GLuint *t = &triangles[3 * fans[from][n]];
+		if (t[0] != to && t[1] != to && t[2] != to) {
+			continue;
+		}
+		if (shared == 2) {
+			return false;
+		}
+		for (int corner = 0; corner < 3; ++corner) {
+			if (t[corner] != from && t[corner] != to) {
+				opposite[shared] = t[corner];
+			}
+		}
+		++shared;
+	}
+	if (shared != 2) {
+		return false;
+	}
+
+	neighbours(from, neighboursFrom);
+	neighbours(to, neighboursTo);
+	size_t common = 0;
+	for (size_t a = 0, b = 0; a < neighboursFrom.size() && b < neighboursTo.size();) {
+		if (neighboursFrom[a] < neighboursTo[b]) {
+			++a;
+		}
+		else if (neighboursTo[b] < neighboursFrom[a]) {
+			++b;
+		}
+		else {
+			++common;
+			++a;
+			++b;
+		}
+	}
+	if (common != 2) {
+		return false;
+	}
+
+	// the opposite corners each lose a triangle and must keep three
+	for (int n = 0; n < 2; ++n) {
+		if (fans[opposite[n]].size() <= 3) {
+			return false;
+		}
+	}
+
+	return keepsOrientation(from, to, collapse.position) && keepsOrientation(to, from, collapse.position);
+}
+
+// whether the triangles around moved, other than those it shares with other,
+// still face about the same way once moved goes to position
+bool Decimator::keepsOrientation(GLuint moved, GLuint other, const double position[3]) const {
+	for (size_t n = 0; n < fans[moved].size(); ++n) {
+		const GLuint *t = &triangles[3 * fans[moved][n]];
+		if (t[0] == other || t[1] == other || t[2] == other) {
+			continue;
+		}
+		int corner = t[0] == moved ? 0 : (t[1] == moved ? 1 : 2);
+		const double *p0 = &positions[3 * t[corner]];
+		const double *p1 = &positions[3 * t[(corner + 1) % 3]];
+		const double *p2 = &positions[3 * t[(corner + 2) % 3]];
+		double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		double f1[3] = { p1[0] - position[0], p1[1] - position[1], p1[2] - position[2] };
+		double f2[3] = { p2[0] - position[0], p2[1] - position[1], p2[2] - position[2] };
+		double before[3], after[3];
+		cross(e1, e2, before);
+		cross(f1, f2, after);
+		double lengths = std::sqrt(dot(before, before) * dot(after, after));
+		if (lengths <= 0 || dot(before, after) < MIN_NORMAL_COS * lengths) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void Decimator::collapse(const Collapse &collapse) {
+	GLuint from = collapse.from;
+	GLuint to = collapse.to;
+
+	for (size_t n = 0; n < fans[from].size(); ++n) {
+		GLuint t = fans[from][n];
+		GLuint *v = &triangles[3 * t];
+		if (v[0] == to || v[1] == to || v[2] == to) {
+			// the two triangles on the edge go, from the fans of all three corners
+			triangleAlive[t] = false;
+			--liveTriangles;
+			for (int corner = 0; corner < 3; ++corner) {
+				if (v[corner] != from) {
+					std::vector<GLuint> &fan = fans[v[corner]];
+					fan.erase(std::find(fan.begin(), fan.end(), t));
+				}
+			}
+			continue;
+		}
+		for (int corner = 0; corner < 3; ++corner) {
+			if (v[corner] == from) {
+				v[corner] = to;
+			}
+		}
+		fans[to].push_back(t);
+	}
+	fans[from].clear();
+	vertexAlive[from] = false;
+	++stamps[from];
+
+	// the normal of whichever end the vertex stays on, or else of both
+	double *p = &positions[3 * to];
+	const double *q = &positions[3 * from];
+	GLfloat *n = &normals[3 * to];
+	const GLfloat *m = &normals[3 * from];
+	const double *target = collapse.position;
+	if (target[0] == q[0] && target[1] == q[1] && target[2] == q[2]) {
+		std::copy(m, m + 3, n);
+	}
+	else if (target[0] != p[0] || target[1] != p[1] || target[2] != p[2]) {
+		GLfloat sum[3] = { n[0] + m[0], n[1] + m[1], n[2] + m[2] };
+		GLfloat length = std::sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+		if (length > 0) {
+			for (int axis = 0; axis < 3; ++axis) {
+				n[axis] = sum[axis] / length;
+			}
+		}
+	}
+	std::copy(target, target + 3, p);
+	quadrics[to].add(quadrics[from]);
+	++stamps[to];
+
+	// the edges round to have a new quadric at one end
+	neighbours(to, neighboursTo);
+	for (size_t k = 0; k < neighboursTo.size(); ++k) {
+		queueEdge(to, neighboursTo[k]);
+	}
+}
+
+void Decimator::run(const DecimationSettings &settings) {
+	double bound = (double)settings.maxError * settings.maxError;
+	while (!heap.empty() && (settings.targetTriangles == 0 || liveTriangles > settings.targetTriangles)) {
+		std::pop_heap(heap.begin(), heap.end(), Costlier());
+		QueuedEdge edge = heap.back();
+		heap.pop_back();
+		if (!vertexAlive[edge.a] || !vertexAlive[edge.b] || stamps[edge.a] != edge.aStamp || stamps[edge.b] != edge.bStamp) {
+			continue;
+		}
+		if (settings.targetTriangles == 0 && edge.cost > bound) {
+			break;
+		}
+		// planned again rather than kept in the heap, which stays small
+		Collapse next;
+		plan(edge.a, edge.b, next);
+		if (canCollapse(next)) {
+			collapse(next);
+		}
+	}
+}
+
+Surface Decimator::result() const {
+	Surface surface;
+	std::vector<GLuint> renumber(vertexAlive.size(), NO_VERTEX);
+	for (size_t t = 0; t < triangleAlive.size(); ++t) {
+		if (!triangleAlive[t]) {
+			continue;
+		}
+		for (int corner = 0; corner < 3; ++corner) {
+			renumber[triangles[3 * t + corner]] = 0;
+		}
+	}
+
+	GLuint count = 0;
+	for (size_t v = 0; v < renumber.size(); ++v) {
+		if (renumber[v] == NO_VERTEX) {
+			continue;
+		}
+		renumber[v] = count++;
+		for (int axis = 0; axis < 3; ++axis) {
+			surface.vertices.push_back((GLfloat)positions[3 * v + axis]);
+			surface.normals.push_back(normals[3 * v + axis]);
+		}
+	}
+
+	surface.indices.reserve(3 * liveTriangles);
+	for (size_t t = 0; t < triangleAlive.size(); ++t) {
+		if (triangleAlive[t]) {
+			for (int corner = 0; corner < 3; ++corner) {
+				surface.indices.push_back(renumber[triangles[3 * t + corner]]);
+			}
+		}
+	}
+	return surface;
+}
+
+Surface decimateSurface(const Surface &surface, const DecimationSettings &settings) {
+	Decimator decimator(surface);
+	decimator.run(settings);
+	return decimator.result();
+}
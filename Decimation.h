@@ -0,0 +1,30 @@
+#include <cstddef>
+#include "Surface.h"
+
+#ifndef DECIMATION_H
+#define DECIMATION_H
+
+// When decimateSurface stops. It collapses edges, cheapest first, until the
+// surface is down to targetTriangles. With targetTriangles 0 it stops instead
+// before the first collapse that would move the surface more than maxError
+// from the triangles it replaces. The error of a vertex is the root mean
+// square distance, weighted by area, to the planes of the original triangles
+// merged into it.
+struct DecimationSettings {
+	size_t targetTriangles;
+	GLfloat maxError;
+
+	DecimationSettings();
+};
+
+// Surface simplified by quadric error edge collapses (Garland and Heckbert).
+// Each collapse merges an edge into one vertex placed where its quadric is
+// least, taken from a heap that is refreshed around every collapse. Vertices
+// on open or non-manifold edges, or where two fans meet, never move, so that
+// the faces of chunks left open still meet their neighbours. Collapses that
+// would join two sheets, fold a vertex to valence two or flip a triangle are
+// refused. Surviving vertices keep their order, and their normals blend those
+// of the vertices merged into them.
+Surface decimateSurface(const Surface &surface, const DecimationSettings &settings);
+
+#endif
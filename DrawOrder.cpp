@@ -0,0 +1,292 @@
+#include "DrawOrder.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// a run of triangles is cut into a new cluster once its vertices per triangle
+// come within this factor of the whole run's, from a cold cache
+static const double CLUSTER_THRESHOLD = 1.05;
+
+// FIFO post-transform cache. A vertex is in it while fewer than size vertices
+// were transformed after it, so a miss is one step of the clock
+class FifoCache {
+public:
+	FifoCache(size_t vertexCount, int size) : stamps(vertexCount, 0), size(size), clock(size + 1) {}
+
+	// how many vertices of triangle had to be transformed
+	int missesOf(const GLuint *triangle) {
+		int misses = 0;
+		for (int corner = 0; corner < 3; ++corner) {
+			GLuint v = triangle[corner];
+			if (clock - stamps[v] > (unsigned)size) {
+				stamps[v] = clock++;
+				++misses;
+			}
+		}
+		return misses;
+	}
+
+	void flush() {
+		clock += size + 1;
+	}
+
+private:
+	std::vector<unsigned> stamps;
+	int size;
+	unsigned clock;
+};
+
+CacheStats simulateVertexCache(const Surface &surface, int cacheSize) {
+	CacheStats stats = { 0, 0 };
+	size_t triangleCount = surface.triangleCount();
+	if (triangleCount == 0) {
+		return stats;
+	}
+	FifoCache cache(surface.vertexCount(), cacheSize);
+	size_t misses = 0;
+	for (size_t t = 0; t < triangleCount; ++t) {
+		misses += cache.missesOf(&surface.indices[3 * t]);
+	}
+	stats.acmr = (double)misses / triangleCount;
+	stats.atvr = (double)misses / surface.vertexCount();
+	return stats;
+}
+
+// Tipsify: emit every triangle round a fanning vertex, then fan next round the
+// vertex of those just emitted that has been longest in the cache and will
+// still be there after its own triangles are drawn. Without one, backtrack to
+// the latest vertex emitted with triangles left, or else the next in number
+static void tipsify(const std::vector<GLuint> &indices, size_t vertexCount, int cacheSize, std::vector<GLuint> &ordered) {
+	size_t triangleCount = indices.size() / 3;
+
+	// the triangles round each vertex, and how many of them are still to be emitted
+	std::vector<GLuint> offsets(vertexCount + 1, 0);
+	for (size_t n = 0; n < indices.size(); ++n) {
+		++offsets[indices[n] + 1];
+	}
+	for (size_t v = 0; v < vertexCount; ++v) {
+		offsets[v + 1] += offsets[v];
+	}
+	std::vector<GLuint> live(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v) {
+		live[v] = offsets[v + 1] - offsets[v];
+	}
+	std::vector<GLuint> adjacency(indices.size());
+	std::vector<GLuint> filled(offsets.begin(), offsets.end() - 1);
+	for (size_t n = 0; n < indices.size(); ++n) {
+		adjacency[filled[indices[n]]++] = (GLuint)(n / 3);
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned> stamps(vertexCount, 0);
+	unsigned clock = cacheSize + 1;
+	std::vector<GLuint> deadEnds;
+	std::vector<GLuint> candidates;
+	size_t cursor = 0;
+
+	ordered.clear();
+	ordered.reserve(indices.size());
+	GLuint fan = 0;
+	while (fan != NO_VERTEX) {
+		candidates.clear();
+		for (GLuint a = offsets[fan]; a < offsets[fan + 1]; ++a) {
+			GLuint t = adjacency[a];
+			if (emitted[t]) {
+				continue;
+			}
+			emitted[t] = true;
+			for (int corner = 0; corner < 3; ++corner) {
+				GLuint v = indices[3 * t + corner];
+				ordered.push_back(v);
+				deadEnds.push_back(v);
+				candidates.push_back(v);
+				--live[v];
+				if (clock - stamps[v] > (unsigned)cacheSize) {
+					stamps[v] = clock++;
+				}
+			}
+		}
+
+		fan = NO_VERTEX;
+		long best = -1;
+		for (size_t n = 0; n < candidates.size(); ++n) {
+			GLuint v = candidates[n];
+			if (live[v] == 0) {
+				continue;
+			}
+			long priority = 0;
+			if (clock - stamps[v] + 2 * live[v] <= (unsigned)cacheSize) {
+				priority = clock - stamps[v];
+			}
+			if (priority > best) {
+				best = priority;
+				fan = v;
+			}
+		}
+		while (fan == NO_VERTEX && !deadEnds.empty()) {
+			GLuint v = deadEnds.back();
+			deadEnds.pop_back();
+			if (live[v] > 0) {
+				fan = v;
+			}
+		}
+		for (; fan == NO_VERTEX && cursor < vertexCount; ++cursor) {
+			if (live[cursor] > 0) {
+				fan = (GLuint)cursor;
+			}
+		}
+	}
+}
+
+// Cut the triangles of indices into clusters and draw the clusters facing out
+// from the surface's centroid first (the fast overdraw pass of Tipsify). A
+// cluster starts at every triangle whose three vertices all miss the cache,
+// and again wherever a run has reached within CLUSTER_THRESHOLD of the cache
+// use of the cluster it is in, so that cutting there costs little
+static void sortClusters(const Surface &surface, std::vector<GLuint> &indices, int cacheSize) {
+	size_t triangleCount = indices.size() / 3;
+	FifoCache cache(surface.vertexCount(), cacheSize);
+
+	std::vector<size_t> hard;
+	for (size_t t = 0; t < triangleCount; ++t) {
+		if (cache.missesOf(&indices[3 * t]) == 3 || t == 0) {
+			hard.push_back(t);
+		}
+	}
+	hard.push_back(triangleCount);
+
+	std::vector<size_t> starts;
+	for (size_t c = 0; c + 1 < hard.size(); ++c) {
+		size_t begin = hard[c];
+		size_t end = hard[c + 1];
+		cache.flush();
+		size_t misses = 0;
+		for (size_t t = begin; t < end; ++t) {
+			misses += cache.missesOf(&indices[3 * t]);
+		}
+		double threshold = CLUSTER_THRESHOLD * misses / (end - begin);
+
+		starts.push_back(begin);
+		cache.flush();
+		size_t runMisses = 0;
+		size_t runTriangles = 0;
+		for (size_t t = begin; t + 1 < end; ++t) {
+			runMisses += cache.missesOf(&indices[3 * t]);
+			++runTriangles;
+			if (runMisses <= threshold * runTriangles) {
+				starts.push_back(t + 1);
+				cache.flush();
+				runMisses = 0;
+				runTriangles = 0;
+			}
+		}
+	}
+	starts.push_back(triangleCount);
+	size_t clusterCount = starts.size() - 1;
+
+	// area weighted centroid and normal of every cluster and of the surface
+	std::vector<double> centroids(3 * clusterCount, 0.0);
+	std::vector<double> normals(3 * clusterCount, 0.0);
+	std::vector<double> areas(clusterCount, 0.0);
+	double middle[3] = { 0, 0, 0 };
+	double total = 0;
+	for (size_t c = 0; c < clusterCount; ++c) {
+		for (size_t t = starts[c]; t < starts[c + 1]; ++t) {
+			const GLfloat *p0 = &surface.vertices[3 * indices[3 * t]];
+			const GLfloat *p1 = &surface.vertices[3 * indices[3 * t + 1]];
+			const GLfloat *p2 = &surface.vertices[3 * indices[3 * t + 2]];
+			double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			double area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			for (int axis = 0; axis < 3; ++axis) {
+				double centre = (p0[axis] + p1[axis] + p2[axis]) / 3;
+				centroids[3 * c + axis] += area * centre;
+				normals[3 * c + axis] += n[axis];
+				middle[axis] += area * centre;
+			}
+			areas[c] += area;
+			total += area;
+		}
+	}
+	if (total > 0) {
+		for (int axis = 0; axis < 3; ++axis) {
+			middle[axis] /= total;
+		}
+	}
+
+	// how far out a cluster faces: its offset from the middle along its normal
+	std::vector<double> facing(clusterCount, 0.0);
+	for (size_t c = 0; c < clusterCount; ++c) {
+		const double *n = &normals[3 * c];
+		double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if (areas[c] <= 0 || length <= 0) {
+			continue;
+		}
+		for (int axis = 0; axis < 3; ++axis) {
+			facing[c] += (centroids[3 * c + axis] / areas[c] - middle[axis]) * n[axis] / length;
+		}
+	}
+
+	std::vector<size_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c) {
+		order[c] = c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&facing](size_t a, size_t b) {
+		return facing[a] > facing[b];
+	});
+
+	std::vector<GLuint> sorted;
+	sorted.reserve(indices.size());
+	for (size_t n = 0; n < clusterCount; ++n) {
+		size_t c = order[n];
+		sorted.insert(sorted.end(), indices.begin() + 3 * starts[c], indices.begin() + 3 * starts[c + 1]);
+	}
+	indices.swap(sorted);
+}
+
+// number the vertices in the order the triangles first use them; any unused go last
+static void orderVertices(Surface &surface) {
+	size_t vertexCount = surface.vertexCount();
+	std::vector<GLuint> renumber(vertexCount, NO_VERTEX);
+	GLuint next = 0;
+	for (size_t n = 0; n < surface.indices.size(); ++n) {
+		GLuint &v = surface.indices[n];
+		if (renumber[v] == NO_VERTEX) {
+			renumber[v] = next++;
+		}
+		v = renumber[v];
+	}
+	for (size_t v = 0; v < vertexCount; ++v) {
+		if (renumber[v] == NO_VERTEX) {
+			renumber[v] = next++;
+		}
+	}
+
+	bool hasNormals = surface.normals.size() == surface.vertices.size();
+	std::vector<GLfloat> vertices(surface.vertices.size());
+	std::vector<GLfloat> normals(hasNormals ? surface.normals.size() : 0);
+	for (size_t v = 0; v < vertexCount; ++v) {
+		for (int axis = 0; axis < 3; ++axis) {
+			vertices[3 * renumber[v] + axis] = surface.vertices[3 * v + axis];
+			if (hasNormals) {
+				normals[3 * renumber[v] + axis] = surface.normals[3 * v + axis];
+			}
+		}
+	}
+	surface.vertices.swap(vertices);
+	if (hasNormals) {
+		surface.normals.swap(normals);
+	}
+}
+
+void optimizeDrawOrder(Surface &surface, int cacheSize) {
+	if (surface.indices.empty()) {
+		return;
+	}
+	std::vector<GLuint> ordered;
+	tipsify(surface.indices, surface.vertexCount(), cacheSize, ordered);
+	sortClusters(surface, ordered, cacheSize);
+	surface.indices.swap(ordered);
+	orderVertices(surface);
+}
@@ -0,0 +1,30 @@
+#include <cstddef>
+#include "Surface.h"
+
+#ifndef DRAWORDER_H
+#define DRAWORDER_H
+
+// vertices the post-transform cache of most GPUs holds, as a FIFO
+const int VERTEX_CACHE_SIZE = 16;
+
+// How drawing a surface's triangles in order uses a FIFO vertex cache of
+// cacheSize vertices. acmr is the vertices transformed per triangle: 3 at
+// worst, and about 0.5 at best on a large closed mesh. atvr is the vertices
+// transformed per vertex of the surface, at best 1.
+struct CacheStats {
+	double acmr;
+	double atvr;
+};
+
+CacheStats simulateVertexCache(const Surface &surface, int cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorder surface for drawing, in about linear time. The triangles are laid
+// out by Tipsify (Sander, Nehab and Barczak), fanning round the vertices that
+// will still be in the cache. The run is then cut into clusters that keep
+// most of that locality, and the clusters facing out from the middle of the
+// surface are drawn first, so that they hide those behind them. Last, the
+// vertices are renumbered in the order the triangles first use them, so the
+// vertex buffer is read front to back. The surface drawn does not change.
+void optimizeDrawOrder(Surface &surface, int cacheSize = VERTEX_CACHE_SIZE);
+
+#endif
@@ -0,0 +1,292 @@
+#include "DualSurface.h"
+#include <algorithm>
+#include <cmath>
+
+#include "MarchingCubes.h"
+#include "ThreadPool.h"
+
+// eigenvalues at or below this share of the largest are dropped from the QEF,
+// so the vertex only moves along the normals the crossings agree on
+static const double QEF_CUTOFF = 0.1;
+
+// the twelve edges of a cell: the corner each starts from, as steps along i, j and k, then its axis
+static const int CELL_EDGES[12][4] = {
+	{ 0, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 1, 1, 0 },
+	{ 0, 0, 0, 1 }, { 1, 0, 0, 1 }, { 0, 0, 1, 1 }, { 1, 0, 1, 1 },
+	{ 0, 0, 0, 2 }, { 1, 0, 0, 2 }, { 0, 1, 0, 2 }, { 1, 1, 0, 2 }
+};
+
+// eigenvalues of the symmetric a into its diagonal and eigenvectors into the columns of v, by Jacobi rotations
+static void symmetricEigen(double a[3][3], double v[3][3]) {
+	for (int r = 0; r < 3; ++r) {
+		for (int c = 0; c < 3; ++c) {
+			v[r][c] = r == c ? 1 : 0;
+		}
+	}
+
+	for (int sweep = 0; sweep < 16; ++sweep) {
+		if (a[0][1] * a[0][1] + a[0][2] * a[0][2] + a[1][2] * a[1][2] < 1e-24) {
+			return;
+		}
+		for (int p = 0; p < 2; ++p) {
+			for (int q = p + 1; q < 3; ++q) {
+				if (a[p][q] == 0) {
+					continue;
+				}
+				double theta = (a[q][q] - a[p][p]) / (2 * a[p][q]);
+				double t = (theta >= 0 ? 1 : -1) / (std::fabs(theta) + std::sqrt(theta * theta + 1));
+				double c = 1 / std::sqrt(t * t + 1);
+				double s = t * c;
+				for (int k = 0; k < 3; ++k) {
+					double kp = a[k][p], kq = a[k][q];
+					a[k][p] = c * kp - s * kq;
+					a[k][q] = s * kp + c * kq;
+				}
+				for (int k = 0; k < 3; ++k) {
+					double pk = a[p][k], qk = a[q][k];
+					a[p][k] = c * pk - s * qk;
+					a[q][k] = s * pk + c * qk;
+				}
+				for (int k = 0; k < 3; ++k) {
+					double kp = v[k][p], kq = v[k][q];
+					v[k][p] = c * kp - s * kq;
+					v[k][q] = s * kp + c * kq;
+				}
+			}
+		}
+	}
+}
+
+// the point nearest, in least squares, to the planes through points along
+// normals, solved about their mean and clamped to the cell [lo, hi]
+static void solveQef(const GLfloat points[][3], const GLfloat normals[][3], int count, const GLfloat mass[3],
+	const GLfloat lo[3], const GLfloat hi[3], GLfloat out[3]) {
+	double ata[3][3] = { { 0 } };
+	double atb[3] = { 0, 0, 0 };
+	for (int n = 0; n < count; ++n) {
+		double d = 0;
+		for (int axis = 0; axis < 3; ++axis) {
+			d += normals[n][axis] * (points[n][axis] - mass[axis]);
+		}
+		for (int r = 0; r < 3; ++r) {
+			for (int c = 0; c < 3; ++c) {
+				ata[r][c] += normals[n][r] * normals[n][c];
+			}
+			atb[r] += normals[n][r] * d;
+		}
+	}
+
+	double v[3][3];
+	symmetricEigen(ata, v);
+	double largest = std::max(ata[0][0], std::max(ata[1][1], ata[2][2]));
+	double x[3] = { 0, 0, 0 };
+	for (int e = 0; e < 3; ++e) {
+		double lambda = ata[e][e];
+		if (lambda <= QEF_CUTOFF * largest || lambda <= 0) {
+			continue;
+		}
+		double along = (v[0][e] * atb[0] + v[1][e] * atb[1] + v[2][e] * atb[2]) / lambda;
+		for (int axis = 0; axis < 3; ++axis) {
+			x[axis] += along * v[axis][e];
+		}
+	}
+
+	for (int axis = 0; axis < 3; ++axis) {
+		out[axis] = std::min(std::max((GLfloat)(mass[axis] + x[axis]), lo[axis]), hi[axis]);
+	}
+}
+
+void extractDualSurface(const ScalarVolume &vals, GLfloat* vertex[3], const EdgeCache &vert_dic, ThreadPool *pool,
+	Surface &surface, const ScalarVolume *container, bool placeByPlanes) {
+	size_t n[3] = { vals.getNx(), vals.getNy(), vals.getNz() };
+	if (n[0] < 2 || n[1] < 2 || n[2] < 2) {
+		return;
+	}
+	size_t cells[3] = { n[0] - 1, n[1] - 1, n[2] - 1 };
+
+	const size_t BRICK = BrickMap::BRICK;
+	BrickMap bricks(n[0], n[1], n[2]);
+	parallelFor(pool, bricks.count(0), [&](size_t bi) {
+		bricks.summarizeSlab(vals, bi);
+	});
+
+	// one vertex per cell with a sign change, each slab of cells into its own buffers
+	std::vector<std::vector<size_t>> slabCells(cells[0]);
+	std::vector<std::vector<GLfloat>> slabPoints(cells[0]);
+	std::vector<std::vector<GLfloat>> slabNormals(cells[0]);
+	parallelFor(pool, cells[0], [&](size_t i) {
+		GLfloat points[12][3];
+		GLfloat normals[12][3];
+		for (size_t j = 0; j < cells[1]; ++j) {
+			for (size_t bk = 0; bk < bricks.count(2); ++bk) {
+				if (!bricks.isCrossed(i / BRICK, j / BRICK, bk)) {
+					continue;
+				}
+				size_t kEnd = std::min((bk + 1) * BRICK, cells[2]);
+				for (size_t k = bk * BRICK; k < kEnd; ++k) {
+					int index = vals.cubeIndex(i, j, k);
+					if (index == 0 || index == 255) {
+						continue;
+					}
+
+					int count = 0;
+					GLfloat mass[3] = { 0, 0, 0 };
+					GLfloat normal[3] = { 0, 0, 0 };
+					for (int e = 0; e < 12; ++e) {
+						size_t a[3] = { i + CELL_EDGES[e][0], j + CELL_EDGES[e][1], k + CELL_EDGES[e][2] };
+						int axis = CELL_EDGES[e][3];
+						size_t b[3] = { a[0], a[1], a[2] };
+						b[axis]++;
+						if (vals.isInside(a[0], a[1], a[2]) == vals.isInside(b[0], b[1], b[2])) {
+							continue;
+						}
+
+						// cached intersections lie on the container, so take their normals from it
+						GLfloat intersection;
+						const ScalarVolume *field = &vals;
+						if (vert_dic.lookup(vert_dic.edgeId(a[0], a[1], a[2], axis), intersection)) {
+							field = container != nullptr ? container : &vals;
+						}
+						else {
+							intersection = edgeIntersection(vals, vertex, a[0], a[1], a[2], axis);
+						}
+						for (int c = 0; c < 3; ++c) {
+							points[count][c] = vertex[c][a[c]];
+						}
+						points[count][axis] = intersection;
+						edgeNormal(*field, vertex, a[0], a[1], a[2], axis, intersection, normals[count]);
+						for (int c = 0; c < 3; ++c) {
+							mass[c] += points[count][c];
+							normal[c] += normals[count][c];
+						}
+						count++;
+					}
+
+					for (int c = 0; c < 3; ++c) {
+						mass[c] /= count;
+					}
+					GLfloat point[3] = { mass[0], mass[1], mass[2] };
+					if (placeByPlanes) {
+						GLfloat lo[3] = { vertex[0][i], vertex[1][j], vertex[2][k] };
+						GLfloat hi[3] = { vertex[0][i + 1], vertex[1][j + 1], vertex[2][k + 1] };
+						solveQef(points, normals, count, mass, lo, hi, point);
+					}
+					GLfloat length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+					for (int c = 0; c < 3; ++c) {
+						normal[c] = length > 0 ? normal[c] / length : 0;
+					}
+
+					slabCells[i].push_back((i * cells[1] + j) * cells[2] + k);
+					slabPoints[i].insert(slabPoints[i].end(), point, point + 3);
+					slabNormals[i].insert(slabNormals[i].end(), normal, normal + 3);
+				}
+			}
+		}
+	});
+
+	// a prefix sum over the slab sizes numbers the vertices in cell order
+	std::vector<size_t> firstVertex(cells[0] + 1, 0);
+	for (size_t i = 0; i < cells[0]; ++i) {
+		firstVertex[i + 1] = firstVertex[i] + slabCells[i].size();
+	}
+
+	size_t base = surface.vertexCount();
+	surface.vertices.resize(3 * (base + firstVertex[cells[0]]));
+	surface.normals.resize(surface.vertices.size());
+	std::vector<GLuint> cellVertex(cells[0] * cells[1] * cells[2], NO_VERTEX);
+	parallelFor(pool, cells[0], [&](size_t i) {
+		std::copy(slabPoints[i].begin(), slabPoints[i].end(), surface.vertices.begin() + 3 * (base + firstVertex[i]));
+		std::copy(slabNormals[i].begin(), slabNormals[i].end(), surface.normals.begin() + 3 * (base + firstVertex[i]));
+		for (size_t v = 0; v < slabCells[i].size(); ++v) {
+			cellVertex[slabCells[i][v]] = (GLuint)(base + firstVertex[i] + v);
+		}
+	});
+
+	// a quad across every crossed edge with four cells around it, wound to face
+	// out of the surface. Slabs of lattice points own the edges leaving them,
+	// as in extractSurface
+	std::vector<std::vector<GLuint>> slabIndices(n[0]);
+	parallelFor(pool, n[0], [&](size_t i) {
+		size_t bi = std::min(i, n[0] - 2) / BRICK;
+		for (size_t j = 0; j < n[1]; ++j) {
+			size_t bj = std::min(j, n[1] - 2) / BRICK;
+			for (size_t bk = 0; bk < bricks.count(2); ++bk) {
+				if (!bricks.isCrossed(bi, bj, bk)) {
+					continue;
+				}
+				size_t kEnd = bk + 1 < bricks.count(2) ? (bk + 1) * BRICK : n[2];
+				for (size_t k = bk * BRICK; k < kEnd; ++k) {
+					size_t a[3] = { i, j, k };
+					bool inside = vals.isInside(i, j, k);
+					for (int axis = 0; axis < 3; ++axis) {
+						if (a[axis] + 1 >= n[axis]) {
+							continue;
+						}
+						size_t b[3] = { i, j, k };
+						b[axis]++;
+						if (vals.isInside(b[0], b[1], b[2]) == inside) {
+							continue;
+						}
+
+						// cell q of the four lies on the high side of axis + 1 when bit 0 of q
+						// is set, and of axis + 2 for bit 1; 0, 1, 3, 2 turns anticlockwise
+						// seen from the high end of the edge
+						int p0 = (axis + 1) % 3, p1 = (axis + 2) % 3;
+						GLuint quad[4];
+						static const int ORDER[4] = { 0, 1, 3, 2 };
+						bool complete = true;
+						for (int q = 0; q < 4 && complete; ++q) {
+							size_t cell[3] = { a[0], a[1], a[2] };
+							int bit0 = ORDER[q] & 1, bit1 = ORDER[q] >> 1;
+							if ((!bit0 && cell[p0] == 0) || (!bit1 && cell[p1] == 0)) {
+								complete = false;
+								break;
+							}
+							cell[p0] -= 1 - bit0;
+							cell[p1] -= 1 - bit1;
+							if (cell[p0] >= cells[p0] || cell[p1] >= cells[p1]) {
+								complete = false;
+								break;
+							}
+							quad[q] = cellVertex[(cell[0] * cells[1] + cell[1]) * cells[2] + cell[2]];
+						}
+						if (!complete) {
+							continue;
+						}
+						if (!inside) {
+							std::swap(quad[1], quad[3]);
+						}
+
+						// split along the shorter diagonal
+						const GLfloat *v[4];
+						for (int q = 0; q < 4; ++q) {
+							v[q] = &surface.vertices[3 * quad[q]];
+						}
+						GLfloat d02 = 0, d13 = 0;
+						for (int c = 0; c < 3; ++c) {
+							d02 += (v[0][c] - v[2][c]) * (v[0][c] - v[2][c]);
+							d13 += (v[1][c] - v[3][c]) * (v[1][c] - v[3][c]);
+						}
+						std::vector<GLuint> &indices = slabIndices[i];
+						if (d02 <= d13) {
+							indices.insert(indices.end(), { quad[0], quad[1], quad[2], quad[0], quad[2], quad[3] });
+						}
+						else {
+							indices.insert(indices.end(), { quad[0], quad[1], quad[3], quad[1], quad[2], quad[3] });
+						}
+					}
+				}
+			}
+		}
+	});
+
+	std::vector<size_t> firstIndex(n[0] + 1, 0);
+	for (size_t i = 0; i < n[0]; ++i) {
+		firstIndex[i + 1] = firstIndex[i] + slabIndices[i].size();
+	}
+	size_t indexBase = surface.indices.size();
+	surface.indices.resize(indexBase + firstIndex[n[0]]);
+	parallelFor(pool, n[0], [&](size_t i) {
+		std::copy(slabIndices[i].begin(), slabIndices[i].end(), surface.indices.begin() + indexBase + firstIndex[i]);
+	});
+}
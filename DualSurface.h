@@ -0,0 +1,23 @@
+#include <cstddef>
+#include "Surface.h"
+#include "ScalarVolume.h"
+#include "EdgeCache.h"
+
+#ifndef DUALSURFACE_H
+#define DUALSURFACE_H
+
+class ThreadPool;
+
+// The dual extractors behind extractSurface. Every cell with a sign change
+// gets one vertex, and every crossed edge a quad joining the four cells around
+// it, split along its shorter diagonal. The mesh is about the size of the
+// marching cubes one, with far fewer slivers. Surface nets put the vertex at the mean
+// of the cell's edge crossings. With placeByPlanes it goes where the planes
+// through the crossings, along their normals, best meet (the QEF of dual
+// contouring), which keeps creases such as the rim a container cuts.
+// Crossings and normals are the ones extractSurface makes, taking the
+// intersections cached in vert_dic from container.
+void extractDualSurface(const ScalarVolume &vals, GLfloat* vertex[3], const EdgeCache &vert_dic, ThreadPool *pool,
+	Surface &surface, const ScalarVolume *container, bool placeByPlanes);
+
+#endif
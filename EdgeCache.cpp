@@ -0,0 +1,36 @@
+#include "EdgeCache.h"
+#include <algorithm>
+
+EdgeCache::EdgeCache() : sx(0), sy(0) {}
+
+EdgeCache::EdgeCache(size_t nx, size_t ny, size_t nz) {
+	resize(nx, ny, nz);
+}
+
+void EdgeCache::resize(size_t nx, size_t ny, size_t nz) {
+	this->sy = nz;
+	this->sx = ny * nz;
+	intersections.assign(3 * nx * ny * nz, 0.0f);
+	valid.assign(3 * nx * ny * nz, 0);
+	vertexIds.assign(3 * nx * ny * nz, NO_VERTEX);
+}
+
+void EdgeCache::clear() {
+	std::fill(valid.begin(), valid.end(), 0);
+	std::fill(vertexIds.begin(), vertexIds.end(), NO_VERTEX);
+}
+
+void EdgeCache::clearVertices() {
+	std::fill(vertexIds.begin(), vertexIds.end(), NO_VERTEX);
+}
+
+void EdgeCache::copySlice(size_t from, size_t to) {
+	std::copy(intersections.begin() + 3 * from * sx, intersections.begin() + 3 * (from + 1) * sx, intersections.begin() + 3 * to * sx);
+	std::copy(valid.begin() + 3 * from * sx, valid.begin() + 3 * (from + 1) * sx, valid.begin() + 3 * to * sx);
+	std::copy(vertexIds.begin() + 3 * from * sx, vertexIds.begin() + 3 * (from + 1) * sx, vertexIds.begin() + 3 * to * sx);
+}
+
+void EdgeCache::clearSlice(size_t i) {
+	std::fill(valid.begin() + 3 * i * sx, valid.begin() + 3 * (i + 1) * sx, 0);
+	std::fill(vertexIds.begin() + 3 * i * sx, vertexIds.begin() + 3 * (i + 1) * sx, NO_VERTEX);
+}
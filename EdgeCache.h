@@ -0,0 +1,66 @@
+#include <cstddef>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include "Surface.h"
+
+#ifndef EDGECACHE_H
+#define EDGECACHE_H
+
+// Flat cache of edge intersections for an nx * ny * nz lattice.
+// Edge (i, j, k, axis) runs from sample (i, j, k) one step along axis, so each
+// lattice point owns three edges and every edge has a dense id to index by.
+// Alongside the intersection it remembers the surface vertex emitted for the
+// edge, so neighbouring cells share that vertex instead of duplicating it.
+class EdgeCache {
+public:
+	EdgeCache();
+	EdgeCache(size_t nx, size_t ny, size_t nz);
+
+	void resize(size_t nx, size_t ny, size_t nz);
+	void clear();
+	// forget the vertices but keep the intersections, to extract again
+	void clearVertices();
+
+	// for a window of i-slices rolled along a larger lattice
+	void copySlice(size_t from, size_t to);
+	void clearSlice(size_t i);
+
+	size_t edgeId(size_t i, size_t j, size_t k, int axis) const {
+		return 3 * (i * sx + j * sy + k) + axis;
+	}
+
+	bool lookup(size_t id, GLfloat &intersection) const {
+		if (!valid[id]) {
+			return false;
+		}
+		intersection = intersections[id];
+		return true;
+	}
+
+	void insert(size_t id, GLfloat intersection) {
+		intersections[id] = intersection;
+		valid[id] = 1;
+	}
+
+	bool lookupVertex(size_t id, GLuint &vertex) const {
+		if (vertexIds[id] == NO_VERTEX) {
+			return false;
+		}
+		vertex = vertexIds[id];
+		return true;
+	}
+
+	void insertVertex(size_t id, GLuint vertex) {
+		vertexIds[id] = vertex;
+	}
+
+private:
+	size_t sx, sy;
+
+	std::vector<GLfloat> intersections;
+	std::vector<unsigned char> valid;
+	std::vector<GLuint> vertexIds;
+};
+
+#endif
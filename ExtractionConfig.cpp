@@ -0,0 +1,157 @@
+#include "ExtractionConfig.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+#include "LUTable.h"
+#include "ScalarVolume.h"
+
+// samples per axis of the probe lattice used by estimateExtraction
+static const GLint PROBE_RESOLUTION = 17;
+
+ExtractionConfig::ExtractionConfig() {
+	for (int axis = 0; axis < 3; ++axis) {
+		this->resolution[axis] = 2;
+		this->minCorner[axis] = -1.0f;
+		this->maxCorner[axis] = 1.0f;
+	}
+	this->closeBorder = true;
+	this->method = EXTRACT_MARCHING_CUBES;
+}
+
+ExtractionConfig::ExtractionConfig(GLfloat cubeSize, GLint dim) {
+	for (int axis = 0; axis < 3; ++axis) {
+		this->resolution[axis] = dim;
+		this->minCorner[axis] = -cubeSize;
+		this->maxCorner[axis] = cubeSize;
+	}
+	this->closeBorder = true;
+	this->method = EXTRACT_MARCHING_CUBES;
+}
+
+ExtractionConfig::ExtractionConfig(const GLfloat minCorner[3], const GLfloat maxCorner[3], const GLint resolution[3]) {
+	for (int axis = 0; axis < 3; ++axis) {
+		this->resolution[axis] = resolution[axis];
+		this->minCorner[axis] = minCorner[axis];
+		this->maxCorner[axis] = maxCorner[axis];
+	}
+	this->closeBorder = true;
+	this->method = EXTRACT_MARCHING_CUBES;
+}
+
+ExtractionConfig ExtractionConfig::fromSpacing(const GLfloat minCorner[3], const GLfloat maxCorner[3], const GLfloat spacing[3]) {
+	GLint resolution[3];
+	for (int axis = 0; axis < 3; ++axis) {
+		GLfloat extent = std::fabs(maxCorner[axis] - minCorner[axis]);
+		resolution[axis] = std::max(2, (GLint)std::ceil(extent / spacing[axis]) + 1);
+	}
+	return ExtractionConfig(minCorner, maxCorner, resolution);
+}
+
+GLfloat ExtractionConfig::spacing(int axis) const {
+	return (maxCorner[axis] - minCorner[axis]) / ((GLfloat)resolution[axis] - 1);
+}
+
+std::vector<GLfloat> ExtractionConfig::coordinates(int axis) const {
+	std::vector<GLfloat> coords(resolution[axis]);
+	for (GLint i = 0; i < resolution[axis]; ++i) {
+		GLfloat a = ((GLfloat)i / ((GLfloat)resolution[axis] - 1));
+		coords[i] = maxCorner[axis] * a + minCorner[axis] * (1.0f - a);
+	}
+	return coords;
+}
+
+size_t ExtractionConfig::sampleCount() const {
+	return (size_t)resolution[0] * resolution[1] * resolution[2];
+}
+
+size_t ExtractionConfig::cellCount() const {
+	return (size_t)(resolution[0] - 1) * (resolution[1] - 1) * (resolution[2] - 1);
+}
+
+ExtractionEstimate estimateExtraction(std::shared_ptr<ImplicitFunc> funcA, std::shared_ptr<ImplicitFunc> funcB,
+	const ExtractionConfig &config, int threads) {
+	if (threads <= 0) {
+		threads = std::max(1, (int)std::thread::hardware_concurrency());
+	}
+
+	// classify a coarse lattice over the same box with the calls the extractor makes
+	GLint probeRes[3];
+	for (int axis = 0; axis < 3; ++axis) {
+		probeRes[axis] = std::min(config.resolution[axis], PROBE_RESOLUTION);
+	}
+	ExtractionConfig probe(config.minCorner, config.maxCorner, probeRes);
+	std::vector<GLfloat> coords[3] = { probe.coordinates(0), probe.coordinates(1), probe.coordinates(2) };
+	ScalarVolume probeVals(probeRes[0], probeRes[1], probeRes[2]);
+
+	auto start = std::chrono::steady_clock::now();
+	for (GLint i = 0; i < probeRes[0]; ++i) {
+		funcA->evaluateBlock(&coords[0][i], 1, &coords[1][0], probeRes[1], &coords[2][0], probeRes[2], probeVals.row(i, 0));
+		if (funcB != nullptr) {
+			// the union also samples its container, and is inside where both are negative
+			std::vector<GLfloat> container(probeRes[1] * probeRes[2]);
+			funcB->evaluateBlock(&coords[0][i], 1, &coords[1][0], probeRes[1], &coords[2][0], probeRes[2], &container[0]);
+			for (size_t n = 0; n < container.size(); ++n) {
+				probeVals.row(i, 0)[n] = std::max(probeVals.row(i, 0)[n], container[n]);
+			}
+		}
+		for (GLint j = 0; j < probeRes[1]; ++j) {
+			probeVals.classifyRow(i, j);
+		}
+	}
+	double probeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	size_t probeTriangles = 0;
+	for (GLint i = 0; i < probeRes[0] - 1; ++i) {
+		for (GLint j = 0; j < probeRes[1] - 1; ++j) {
+			for (GLint k = 0; k < probeRes[2] - 1; ++k) {
+				int index = probeVals.cubeIndex(i, j, k);
+				int e = 0;
+				while (e < 13 && aCases[index][e] != -1) {
+					++e;
+				}
+				probeTriangles += e / 3;
+			}
+		}
+	}
+
+	ExtractionEstimate estimate;
+	estimate.samples = config.sampleCount();
+	estimate.evaluations = estimate.samples * (funcB != nullptr ? 2 : 1);
+
+	// a surface crosses cells in proportion to its area, which grows with the
+	// square of the linear resolution
+	double cellRatio = (double)config.cellCount() / std::max<size_t>(1, probe.cellCount());
+	estimate.triangles = (size_t)(probeTriangles * std::pow(cellRatio, 2.0 / 3.0));
+	estimate.vertices = estimate.triangles / 2;
+
+	// the fields (a union keeps its container's samples too), edge cache,
+	// vertices with their normals, and the slab and final index buffers
+	size_t fields = funcB != nullptr ? 2 : 1;
+	size_t edgeBytes = 3 * (sizeof(GLfloat) + 1 + sizeof(GLuint));
+	estimate.peakBytes = estimate.samples * ((sizeof(GLfloat) + 1) * fields + edgeBytes)
+		+ estimate.vertices * (3 * sizeof(GLfloat) + 3 * sizeof(GLfloat))
+		+ 2 * estimate.triangles * 3 * sizeof(GLuint);
+	if (config.method == EXTRACT_MARCHING_CUBES) {
+		// the slab edge lists
+		estimate.peakBytes += estimate.vertices * sizeof(size_t);
+	}
+	else {
+		// a vertex number for every cell, and the slab lists of active cells
+		// with their points and normals until they are copied out
+		estimate.peakBytes += config.cellCount() * sizeof(GLuint)
+			+ estimate.vertices * (sizeof(size_t) + 6 * sizeof(GLfloat));
+	}
+
+	// two slices of each field and of the edge cache, one of cube indices and a
+	// slab of output; streaming always runs marching cubes
+	size_t slice = (size_t)config.resolution[1] * config.resolution[2];
+	size_t slabs = std::max(1, config.resolution[0] - 1);
+	estimate.streamingPeakBytes = 2 * slice * (sizeof(GLfloat) + 1) * fields
+		+ 2 * slice * edgeBytes + slice * sizeof(int)
+		+ (estimate.vertices * 6 * sizeof(GLfloat) + estimate.triangles * 3 * sizeof(GLuint)) / slabs;
+
+	estimate.seconds = probeSeconds / probe.sampleCount() * estimate.samples / threads;
+	return estimate;
+}
@@ -0,0 +1,63 @@
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include "ImplicitFunc.h"
+
+#ifndef EXTRACTIONCONFIG_H
+#define EXTRACTIONCONFIG_H
+
+// How extractSurface turns classified samples into triangles
+enum ExtractionMethod {
+	// a vertex on every crossed edge, triangulated cell by cell from aCases
+	EXTRACT_MARCHING_CUBES,
+	// a vertex in every crossed cell at the mean of its edge crossings
+	EXTRACT_SURFACE_NETS,
+	// a vertex in every crossed cell where the planes of its crossings meet
+	EXTRACT_DUAL_CONTOURING
+};
+
+// Sampling lattice for the extractors: resolution[axis] samples spread evenly
+// from minCorner[axis] to maxCorner[axis], so each axis has its own spacing.
+class ExtractionConfig {
+public:
+	GLint resolution[3];
+	GLfloat minCorner[3];
+	GLfloat maxCorner[3];
+	// whether the single surface extractors close the surface off on the lattice
+	// faces, true by default. Chunks meshed side by side leave them open
+	bool closeBorder;
+	// marching cubes by default; the streaming extractors always use it
+	ExtractionMethod method;
+
+	ExtractionConfig();
+	// dim samples per axis across the cube [-cubeSize, cubeSize]^3
+	ExtractionConfig(GLfloat cubeSize, GLint dim);
+	ExtractionConfig(const GLfloat minCorner[3], const GLfloat maxCorner[3], const GLint resolution[3]);
+
+	// the fewest samples that keep neighbours at most spacing[axis] apart
+	static ExtractionConfig fromSpacing(const GLfloat minCorner[3], const GLfloat maxCorner[3], const GLfloat spacing[3]);
+
+	GLfloat spacing(int axis) const;
+	std::vector<GLfloat> coordinates(int axis) const;
+	size_t sampleCount() const;
+	size_t cellCount() const;
+};
+
+// What an extraction over a config is expected to cost, from the lattice size
+// and a coarse probe of the field.
+struct ExtractionEstimate {
+	size_t samples;
+	size_t evaluations;
+	size_t triangles;
+	size_t vertices;
+	size_t peakBytes;
+	size_t streamingPeakBytes;
+	double seconds;
+};
+
+// funcB is the container of a union and may be null for a single surface;
+// threads is the number of threads the field will be sampled on
+ExtractionEstimate estimateExtraction(std::shared_ptr<ImplicitFunc> funcA, std::shared_ptr<ImplicitFunc> funcB,
+	const ExtractionConfig &config, int threads);
+
+#endif
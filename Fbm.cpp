@@ -0,0 +1,154 @@
+#include "Fbm.h"
+
+const double Fbm::NOISE_LOW = -0.05;
+const double Fbm::NOISE_HIGH = 1.05;
+
+Fbm::Fbm(int octaves, double persistence) {
+	this->octaves = octaves < 1 ? 1 : octaves;
+	this->persistence = persistence;
+
+	// the same products and sums Noise::octave and NoiseF::octave make
+	double f = 1, a = 1;
+	float fF = 1, aF = 1;
+	this->maxValue = 0;
+	this->maxValueF = 0;
+	for (int i = 0; i < this->octaves; i++) {
+		frequency.push_back(f);
+		amplitude.push_back(a);
+		frequencyF.push_back(fF);
+		amplitudeF.push_back(aF);
+		maxValue += a;
+		maxValueF += aF;
+		a *= persistence;
+		f *= 2;
+		aF *= (float)persistence;
+		fF *= 2;
+	}
+
+	remaining.assign(this->octaves + 1, 0);
+	remainingF.assign(this->octaves + 1, 0);
+	for (int i = this->octaves - 1; i >= 0; i--) {
+		remaining[i] = remaining[i + 1] + amplitude[i];
+		remainingF[i] = remainingF[i + 1] + amplitudeF[i];
+	}
+}
+
+template <class N, class T>
+static void sumOctaves(N &noise, const std::vector<T> &frequency, const std::vector<T> &amplitude,
+	const std::vector<T> &remaining, T maxValue, const T *x, const T *y, const T *z, T *out, size_t count,
+	bool stopEarly, T iso, size_t &evaluations) {
+	std::vector<T> total(count, 0);
+	std::vector<size_t> active(count);
+	for (size_t n = 0; n < count; ++n) {
+		active[n] = n;
+	}
+
+	// threshold on the unnormalized sum
+	T target = iso * maxValue;
+	std::vector<T> px(count), py(count), pz(count), value(count);
+	evaluations = 0;
+	for (size_t o = 0; o < frequency.size() && !active.empty(); ++o) {
+		size_t live = active.size();
+		for (size_t a = 0; a < live; ++a) {
+			size_t n = active[a];
+			px[a] = x[n] * frequency[o];
+			py[a] = y[n] * frequency[o];
+			pz[a] = z[n] * frequency[o];
+		}
+		noise.noise(&px[0], &py[0], &pz[0], &value[0], live);
+		evaluations += live;
+
+		size_t kept = 0;
+		T rest = remaining[o + 1];
+		for (size_t a = 0; a < live; ++a) {
+			size_t n = active[a];
+			total[n] += value[a] * amplitude[o];
+			if (stopEarly && rest > 0 && (total[n] + rest * (T)Fbm::NOISE_LOW > target || total[n] + rest * (T)Fbm::NOISE_HIGH < target)) {
+				total[n] += rest / 2;
+				continue;
+			}
+			active[kept++] = n;
+		}
+		active.resize(kept);
+	}
+
+	for (size_t n = 0; n < count; ++n) {
+		out[n] = total[n] / maxValue;
+	}
+}
+
+void Fbm::bounds(Noise &noise, const double lo[3], const double hi[3], double &min, double &max) const {
+	min = 0;
+	max = 0;
+	for (int i = 0; i < octaves; i++) {
+		double octaveLo[3], octaveHi[3];
+		for (int axis = 0; axis < 3; ++axis) {
+			octaveLo[axis] = lo[axis] * frequency[i];
+			octaveHi[axis] = hi[axis] * frequency[i];
+		}
+		double low = NOISE_LOW;
+		double high = NOISE_HIGH;
+		noise.noiseBounds(octaveLo, octaveHi, low, high);
+		min += low * amplitude[i];
+		max += high * amplitude[i];
+	}
+	min /= maxValue;
+	max /= maxValue;
+}
+
+double Fbm::evaluate(Noise &noise, double x, double y, double z) const {
+	double total = 0;
+	for (int i = 0; i < octaves; i++) {
+		total += noise.noise(x * frequency[i], y * frequency[i], z * frequency[i]) * amplitude[i];
+	}
+	return total / maxValue;
+}
+
+float Fbm::evaluate(NoiseF &noise, float x, float y, float z) const {
+	float total = 0;
+	for (int i = 0; i < octaves; i++) {
+		total += noise.noise(x * frequencyF[i], y * frequencyF[i], z * frequencyF[i]) * amplitudeF[i];
+	}
+	return total / maxValueF;
+}
+
+double Fbm::evaluate(Simplex &noise, double x, double y, double z) const {
+	double total = 0;
+	for (int i = 0; i < octaves; i++) {
+		total += noise.noise(x * frequency[i], y * frequency[i], z * frequency[i]) * amplitude[i];
+	}
+	return total / maxValue;
+}
+
+void Fbm::evaluate(Noise &noise, const double *x, const double *y, const double *z, double *out, size_t count) const {
+	size_t evaluations;
+	sumOctaves(noise, frequency, amplitude, remaining, maxValue, x, y, z, out, count, false, 0.0, evaluations);
+}
+
+void Fbm::evaluate(NoiseF &noise, const float *x, const float *y, const float *z, float *out, size_t count) const {
+	size_t evaluations;
+	sumOctaves(noise, frequencyF, amplitudeF, remainingF, maxValueF, x, y, z, out, count, false, 0.0f, evaluations);
+}
+
+void Fbm::evaluate(Simplex &noise, const double *x, const double *y, const double *z, double *out, size_t count) const {
+	size_t evaluations;
+	sumOctaves(noise, frequency, amplitude, remaining, maxValue, x, y, z, out, count, false, 0.0, evaluations);
+}
+
+size_t Fbm::evaluateNear(Noise &noise, const double *x, const double *y, const double *z, double *out, size_t count, double iso) const {
+	size_t evaluations;
+	sumOctaves(noise, frequency, amplitude, remaining, maxValue, x, y, z, out, count, true, iso, evaluations);
+	return evaluations;
+}
+
+size_t Fbm::evaluateNear(NoiseF &noise, const float *x, const float *y, const float *z, float *out, size_t count, float iso) const {
+	size_t evaluations;
+	sumOctaves(noise, frequencyF, amplitudeF, remainingF, maxValueF, x, y, z, out, count, true, iso, evaluations);
+	return evaluations;
+}
+
+size_t Fbm::evaluateNear(Simplex &noise, const double *x, const double *y, const double *z, double *out, size_t count, double iso) const {
+	size_t evaluations;
+	sumOctaves(noise, frequency, amplitude, remaining, maxValue, x, y, z, out, count, true, iso, evaluations);
+	return evaluations;
+}
@@ -0,0 +1,64 @@
+#include <cstddef>
+#include <vector>
+#include "Noise.h"
+#include "NoiseF.h"
+#include "Simplex.h"
+
+#ifndef FBM_H
+#define FBM_H
+
+// Fractal sum of noise octaves as in Noise::octave: each octave doubles the
+// frequency and scales the amplitude by persistence. The frequencies,
+// amplitudes and the amplitude still to come after each octave are
+// tabulated once, and a batch runs every octave over all of its points.
+class Fbm {
+public:
+	Fbm(int octaves = 1, double persistence = 0.5);
+
+	int getOctaves() const { return octaves; }
+	double getPersistence() const { return persistence; }
+
+	// the same values as Noise::octave, NoiseF::octave and Simplex::octave
+	double evaluate(Noise &noise, double x, double y, double z) const;
+	float evaluate(NoiseF &noise, float x, float y, float z) const;
+	double evaluate(Simplex &noise, double x, double y, double z) const;
+	void evaluate(Noise &noise, const double *x, const double *y, const double *z, double *out, size_t count) const;
+	void evaluate(NoiseF &noise, const float *x, const float *y, const float *z, float *out, size_t count) const;
+	void evaluate(Simplex &noise, const double *x, const double *y, const double *z, double *out, size_t count) const;
+
+	// As evaluate, but a point stops as soon as the octaves left cannot carry
+	// its sum back across iso, and gets the middle of what they could still
+	// add. Which side of iso each point is on is exact; values away from iso
+	// are approximate. Only valid where each octave is within [NOISE_LOW,
+	// NOISE_HIGH]: coordinates >= 0 for Perlin noise, anywhere for Simplex.
+	// Returns the number of noise evaluations.
+	size_t evaluateNear(Noise &noise, const double *x, const double *y, const double *z, double *out, size_t count, double iso) const;
+	size_t evaluateNear(NoiseF &noise, const float *x, const float *y, const float *z, float *out, size_t count, float iso) const;
+	size_t evaluateNear(Simplex &noise, const double *x, const double *y, const double *z, double *out, size_t count, double iso) const;
+
+	// bounds on evaluate(noise, ...) over the box [lo, hi]: the octaves'
+	// Noise::noiseBounds, or [NOISE_LOW, NOISE_HIGH] where they give none,
+	// weighted by amplitude
+	void bounds(Noise &noise, const double lo[3], const double hi[3], double &min, double &max) const;
+
+	// range of one octave of noise, with a margin over the 3D Perlin extremes
+	static const double NOISE_LOW;
+	static const double NOISE_HIGH;
+
+private:
+	int octaves;
+	double persistence;
+
+	std::vector<double> frequency;
+	std::vector<double> amplitude;
+	std::vector<double> remaining;
+	double maxValue;
+
+	// the same tables accumulated in float, as NoiseF::octave does
+	std::vector<float> frequencyF;
+	std::vector<float> amplitudeF;
+	std::vector<float> remainingF;
+	float maxValueF;
+};
+
+#endif
@@ -1,3 +1,5 @@
+#include <cstddef>
+#include <limits>
 #define GLEW_STATIC
 #include <Gl/glew.h>
 
@@ -11,6 +13,62 @@ public:
 	virtual void incXoff(float inc) = 0;
 	virtual void incYoff(float inc) = 0;
 	virtual void incZoff(float inc) = 0;
+
+	// function over the lattice xs[0..nx) x ys[0..ny) x zs[0..nz), written to out
+	// with z fastest, then y, then x. Overrides hoist per-axis work out of the loop.
+	virtual void evaluateBlock(const GLfloat *xs, size_t nx, const GLfloat *ys, size_t ny,
+		const GLfloat *zs, size_t nz, GLfloat *out) {
+		for (size_t i = 0; i < nx; ++i) {
+			for (size_t j = 0; j < ny; ++j) {
+				for (size_t k = 0; k < nz; ++k) {
+					*out++ = function(xs[i], ys[j], zs[k]);
+				}
+			}
+		}
+	}
+
+	// function at count scattered points, for extractors that do not sample a whole lattice
+	virtual void evaluatePoints(const GLfloat *x, const GLfloat *y, const GLfloat *z, GLfloat *out, size_t count) {
+		for (size_t n = 0; n < count; ++n) {
+			out[n] = function(x[n], y[n], z[n]);
+		}
+	}
+
+	// Fields thresholded at an iso level are function = raw - getIso(). The
+	// extractors keep the raw samples to move the level without resampling;
+	// by default the function is its own raw field at level 0
+	virtual GLfloat getIso() const {
+		return 0;
+	}
+
+	virtual void evaluateRawBlock(const GLfloat *xs, size_t nx, const GLfloat *ys, size_t ny,
+		const GLfloat *zs, size_t nz, GLfloat *out) {
+		evaluateBlock(xs, nx, ys, ny, zs, nz, out);
+	}
+
+	// After incXoff(d), function(x, y, z) is what function(x + d * offsetScale(), y, z)
+	// was, and incZoff does the same along z. 0 when the offsets change nothing
+	virtual GLfloat offsetScale() const {
+		return 0;
+	}
+
+	// bounds on function over the box [lo[0], hi[0]] x [lo[1], hi[1]] x [lo[2], hi[2]],
+	// for the extractors to skip boxes the surface cannot cross. The default
+	// bounds nothing; overrides may be loose but never too narrow
+	virtual void bounds(const GLfloat /*lo*/[3], const GLfloat /*hi*/[3], GLfloat &min, GLfloat &max) {
+		min = -std::numeric_limits<GLfloat>::infinity();
+		max = std::numeric_limits<GLfloat>::infinity();
+	}
+
+	// function(x, y, z), with its gradient written to grad. The default takes
+	// central differences; overrides differentiate analytically.
+	virtual GLfloat gradient(GLfloat x, GLfloat y, GLfloat z, GLfloat grad[3]) {
+		const GLfloat h = 1e-3f;
+		grad[0] = (function(x + h, y, z) - function(x - h, y, z)) / (2 * h);
+		grad[1] = (function(x, y + h, z) - function(x, y - h, z)) / (2 * h);
+		grad[2] = (function(x, y, z + h) - function(x, y, z - h)) / (2 * h);
+		return function(x, y, z);
+	}
 };
 
 #endif
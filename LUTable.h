@@ -256,4 +256,22 @@ static __int8 aCases[256][13] =
 	{ 9, 1, 0,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1 },
 	{ 8, 0, 3,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1 },
 	{ -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1 }
-};
\ No newline at end of file
+};
+
+// lower end (di, dj, dk) of each cube edge relative to the cell's (i, j, k) corner,
+// followed by the axis the edge runs along (0 = x, 1 = y, 2 = z)
+static const int aEdges[12][4] =
+{
+	{ 0, 0, 0, 0 },
+	{ 1, 0, 0, 2 },
+	{ 0, 0, 1, 0 },
+	{ 0, 0, 0, 2 },
+	{ 0, 1, 0, 0 },
+	{ 1, 1, 0, 2 },
+	{ 0, 1, 1, 0 },
+	{ 0, 1, 0, 2 },
+	{ 0, 0, 0, 1 },
+	{ 1, 0, 0, 1 },
+	{ 1, 0, 1, 1 },
+	{ 0, 0, 1, 1 }
+};
\ No newline at end of file
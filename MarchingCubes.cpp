@@ -0,0 +1,885 @@
+#include "MarchingCubes.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+
+#include "LUTable.h"
+#include "ScalarVolume.h"
+#include "EdgeCache.h"
+#include "ThreadPool.h"
+#include "DualSurface.h"
+
+// whether the edge from (i, j, k) along axis joins an inside and an outside sample
+static bool crossesEdge(const ScalarVolume &vals, size_t i, size_t j, size_t k, int axis) {
+	size_t end[3] = { i, j, k };
+	size_t size[3] = { vals.getNx(), vals.getNy(), vals.getNz() };
+	end[axis]++;
+	if (end[axis] >= size[axis]) {
+		return false;
+	}
+	return vals.isInside(i, j, k) != vals.isInside(end[0], end[1], end[2]);
+}
+
+GLfloat edgeIntersection(const ScalarVolume &vals, GLfloat* vertex[3], size_t i, size_t j, size_t k, int axis) {
+	size_t lattice[3] = { i, j, k };
+	GLfloat a = vertex[axis][lattice[axis]];
+	GLfloat aVal = vals.value(i, j, k);
+	GLfloat b = vertex[axis][lattice[axis] + 1];
+	lattice[axis]++;
+	GLfloat bVal = vals.value(lattice[0], lattice[1], lattice[2]);
+	return interpolate(a, aVal, b, bVal);
+}
+
+// gradient of vals at sample (i, j, k) by central differences, one-sided on
+// the faces of the lattice
+static void sampleGradient(const ScalarVolume &vals, GLfloat* vertex[3], size_t i, size_t j, size_t k, GLfloat grad[3]) {
+	size_t size[3] = { vals.getNx(), vals.getNy(), vals.getNz() };
+	for (int axis = 0; axis < 3; ++axis) {
+		size_t lo[3] = { i, j, k };
+		size_t hi[3] = { i, j, k };
+		if (lo[axis] > 0) {
+			lo[axis]--;
+		}
+		if (hi[axis] + 1 < size[axis]) {
+			hi[axis]++;
+		}
+		GLfloat run = vertex[axis][hi[axis]] - vertex[axis][lo[axis]];
+		GLfloat rise = vals.value(hi[0], hi[1], hi[2]) - vals.value(lo[0], lo[1], lo[2]);
+		grad[axis] = run != 0 ? rise / run : 0;
+	}
+}
+
+// scale a gradient to unit length. The field is negative inside, so the
+// gradient already points out of the surface, the way the triangles wind
+static void toNormal(GLfloat grad[3]) {
+	GLfloat length = std::sqrt(grad[0] * grad[0] + grad[1] * grad[1] + grad[2] * grad[2]);
+	for (int axis = 0; axis < 3; ++axis) {
+		grad[axis] = length > 0 ? grad[axis] / length : 0;
+	}
+}
+
+// the sample gradients at both ends, blended as the values are
+void edgeNormal(const ScalarVolume &vals, GLfloat* vertex[3], size_t i, size_t j, size_t k, int axis,
+	GLfloat intersection, GLfloat normal[3]) {
+	size_t end[3] = { i, j, k };
+	end[axis]++;
+	GLfloat a = vertex[axis][end[axis] - 1];
+	GLfloat b = vertex[axis][end[axis]];
+	GLfloat t = b != a ? (intersection - a) / (b - a) : 0;
+
+	GLfloat ga[3], gb[3];
+	sampleGradient(vals, vertex, i, j, k, ga);
+	sampleGradient(vals, vertex, end[0], end[1], end[2], gb);
+	for (int n = 0; n < 3; ++n) {
+		normal[n] = ga[n] + t * (gb[n] - ga[n]);
+	}
+	toNormal(normal);
+}
+
+// classify row (i, j) of vals as inside both itself and container, whose
+// values are given for the same row: max(a, b) < 0 exactly when a < 0 and b < 0
+static void intersectRow(ScalarVolume &vals, size_t i, size_t j, const GLfloat *container) {
+	const GLfloat *values = vals.row(i, j);
+	for (size_t k = 0; k < vals.getNz(); ++k) {
+		vals.setInside(i, j, k, std::max(values[k], container[k]) < 0);
+	}
+}
+
+Surface genMesh(std::shared_ptr<ImplicitFunc> function, const ExtractionConfig &config, ThreadPool *pool) {
+	//std::cout << "generating mesh..." << std::endl;
+	GLint nx = config.resolution[0];
+	GLint ny = config.resolution[1];
+	GLint nz = config.resolution[2];
+
+	EdgeCache vert_dic(nx, ny, nz);
+
+	// array of values for x, y, z
+	// vertexCoord[0][] = x's, vertexCoord[1][] = y's, vertex Coord[2][] = z's
+	std::vector<GLfloat> coords[3] = { config.coordinates(0), config.coordinates(1), config.coordinates(2) };
+	GLfloat* vertexCoord[3] = { &coords[0][0], &coords[1][0], &coords[2][0] };
+
+	// each sample stores the value from the implicit function
+	// and whether the vertex is inside the surface or not
+	ScalarVolume vertexVals(nx, ny, nz);
+	parallelFor(pool, nx, [&](size_t i) {
+		function->evaluateBlock(&vertexCoord[0][i], 1, vertexCoord[1], ny, vertexCoord[2], nz, vertexVals.row(i, 0));
+		for (GLint j = 0; j < ny; ++j) {
+			vertexVals.classifyRow(i, j);
+		}
+	});
+
+	// close the surface off at the edges of the box
+	if (config.closeBorder) {
+		vertexVals.setBorder(1000000, false);
+	}
+
+
+	// Go through every cube and check vertices;
+	// surface stores each vertex once and three indices per facet
+	Surface surface;
+	extractSurface(vertexVals, vertexCoord, vert_dic, pool, surface, nullptr, config.method);
+	//std::cout << "mesh complete" << std::endl;
+
+	return surface;
+}
+
+Surface genUnion(std::shared_ptr<ImplicitFunc> funcA, std::shared_ptr<ImplicitFunc> funcB, const ExtractionConfig &config, ThreadPool *pool) {
+	//std::cout << "generating mesh..." << std::endl;
+	GLint nx = config.resolution[0];
+	GLint ny = config.resolution[1];
+	GLint nz = config.resolution[2];
+
+	// the container field is kept for the normals of the vertices on it
+	ScalarVolume containerVals(nx, ny, nz);
+	ScalarVolume vertexVals(nx, ny, nz);
+
+	EdgeCache vert_dic(nx, ny, nz);
+
+	Surface surface;
+
+	// array of values for x, y, z
+	// vertexCoord[0][] = x's, vertexCoord[1][] = y's, vertex Coord[2][] = z's
+	std::vector<GLfloat> coords[3] = { config.coordinates(0), config.coordinates(1), config.coordinates(2) };
+	GLfloat* vertexCoord[3] = { &coords[0][0], &coords[1][0], &coords[2][0] };
+
+	// calculate container data
+	parallelFor(pool, nx, [&](size_t i) {
+		funcB->evaluateBlock(&vertexCoord[0][i], 1, vertexCoord[1], ny, vertexCoord[2], nz, containerVals.row(i, 0));
+		for (GLint j = 0; j < ny; ++j) {
+			containerVals.classifyRow(i, j);
+		}
+	});
+
+	// determine outer surface, only caching its edge intersections
+	cacheIntersections(containerVals, vertexCoord, vert_dic, pool);
+
+	// calculate intersection
+	parallelFor(pool, nx, [&](size_t i) {
+		funcA->evaluateBlock(&vertexCoord[0][i], 1, vertexCoord[1], ny, vertexCoord[2], nz, vertexVals.row(i, 0));
+		for (GLint j = 0; j < ny; ++j) {
+			intersectRow(vertexVals, i, j, containerVals.row(i, j));
+		}
+	});
+
+	// Go through every cube and check vertices;
+	// surface stores each vertex once and three indices per facet
+	extractSurface(vertexVals, vertexCoord, vert_dic, pool, surface, &containerVals, config.method);
+
+	return surface;
+}
+
+// Side of the surface each brick of one field is on: -1 inside, 1 outside,
+// or 0 when the bounds leave it open and it has to be sampled. Samples of
+// settled bricks take the value kept in settled, which is on that side.
+struct BrickSides {
+	size_t count[3];
+	std::vector<signed char> side;
+	std::vector<GLfloat> settled;
+
+	size_t index(size_t bi, size_t bj, size_t bk) const {
+		return (bi * count[1] + bj) * count[2] + bk;
+	}
+};
+
+// settle the bricks [lo, hi) of function from its bounds over them, or split
+// the node in two along each axis where it has more than one brick. Bricks that
+// gate settles outside are outside for function too, as in a union
+static void settleNode(ImplicitFunc &function, const std::vector<GLfloat> coords[3], const size_t lo[3], const size_t hi[3],
+	const BrickSides *gate, BrickSides &sides) {
+	const size_t BRICK = BrickMap::BRICK;
+	bool gated = gate != nullptr;
+	for (size_t bi = lo[0]; bi < hi[0] && gated; ++bi) {
+		for (size_t bj = lo[1]; bj < hi[1] && gated; ++bj) {
+			for (size_t bk = lo[2]; bk < hi[2] && gated; ++bk) {
+				gated = gate->side[gate->index(bi, bj, bk)] > 0;
+			}
+		}
+	}
+
+	GLfloat min = 0;
+	GLfloat max = 0;
+	if (!gated) {
+		GLfloat boxLo[3], boxHi[3];
+		for (int axis = 0; axis < 3; ++axis) {
+			boxLo[axis] = coords[axis][lo[axis] * BRICK];
+			boxHi[axis] = coords[axis][std::min(hi[axis] * BRICK, coords[axis].size() - 1)];
+		}
+		function.bounds(boxLo, boxHi, min, max);
+	}
+
+	signed char side = gated || min >= 0 ? 1 : (max < 0 ? -1 : 0);
+	bool leaf = hi[0] - lo[0] == 1 && hi[1] - lo[1] == 1 && hi[2] - lo[2] == 1;
+	if (side != 0 || leaf) {
+		for (size_t bi = lo[0]; bi < hi[0]; ++bi) {
+			for (size_t bj = lo[1]; bj < hi[1]; ++bj) {
+				for (size_t bk = lo[2]; bk < hi[2]; ++bk) {
+					size_t n = sides.index(bi, bj, bk);
+					sides.side[n] = side;
+					sides.settled[n] = gated ? gate->settled[n] : (side > 0 ? min : max);
+				}
+			}
+		}
+		return;
+	}
+
+	size_t mid[3];
+	for (int axis = 0; axis < 3; ++axis) {
+		mid[axis] = hi[axis] - lo[axis] > 1 ? lo[axis] + (hi[axis] - lo[axis]) / 2 : hi[axis];
+	}
+	for (int child = 0; child < 8; ++child) {
+		size_t childLo[3], childHi[3];
+		bool empty = false;
+		for (int axis = 0; axis < 3; ++axis) {
+			bool upper = ((child >> axis) & 1) != 0;
+			childLo[axis] = upper ? mid[axis] : lo[axis];
+			childHi[axis] = upper ? hi[axis] : mid[axis];
+			empty = empty || childLo[axis] == childHi[axis];
+		}
+		if (!empty) {
+			settleNode(function, coords, childLo, childHi, gate, sides);
+		}
+	}
+}
+
+static BrickSides settleBricks(ImplicitFunc &function, const std::vector<GLfloat> coords[3], const BrickSides *gate) {
+	BrickSides sides;
+	size_t lo[3] = { 0, 0, 0 };
+	for (int axis = 0; axis < 3; ++axis) {
+		sides.count[axis] = BrickMap::bricksAlong(coords[axis].size());
+	}
+	sides.side.assign(sides.count[0] * sides.count[1] * sides.count[2], 0);
+	sides.settled.assign(sides.side.size(), 0);
+	settleNode(function, coords, lo, sides.count, gate, sides);
+	return sides;
+}
+
+// first and last brick along an axis of count bricks within one sample of
+// sample s. Brick b holds samples [b * BRICK, (b + 1) * BRICK]
+static void bricksNear(size_t s, size_t count, size_t &first, size_t &last) {
+	const size_t BRICK = BrickMap::BRICK;
+	first = s >= 2 ? (s - 2) / BRICK : 0;
+	last = std::min((s + 1) / BRICK, count - 1);
+}
+
+// function at every sample of the open bricks of sides and the samples around
+// them; the settled value of their brick everywhere else
+static void sampleOpenBricks(ImplicitFunc &function, const std::vector<GLfloat> coords[3], const BrickSides &sides,
+	ScalarVolume &vals, ThreadPool *pool) {
+	const size_t BRICK = BrickMap::BRICK;
+	size_t nx = vals.getNx();
+	size_t ny = vals.getNy();
+	size_t nz = vals.getNz();
+	parallelFor(pool, nx, [&](size_t i) {
+		std::vector<unsigned char> open(ny * nz, 0);
+		size_t biFirst, biLast;
+		bricksNear(i, sides.count[0], biFirst, biLast);
+		for (size_t j = 0; j < ny; ++j) {
+			size_t bjFirst, bjLast;
+			bricksNear(j, sides.count[1], bjFirst, bjLast);
+			for (size_t bi = biFirst; bi <= biLast; ++bi) {
+				for (size_t bj = bjFirst; bj <= bjLast; ++bj) {
+					for (size_t bk = 0; bk < sides.count[2]; ++bk) {
+						if (sides.side[sides.index(bi, bj, bk)] == 0) {
+							size_t kBegin = bk * BRICK > 0 ? bk * BRICK - 1 : 0;
+							size_t kEnd = std::min((bk + 1) * BRICK + 2, nz);
+							std::fill(open.begin() + j * nz + kBegin, open.begin() + j * nz + kEnd, 1);
+						}
+					}
+				}
+			}
+		}
+
+		// a whole open slab goes in one call, as genMesh makes it
+		if (std::find(open.begin(), open.end(), 0) == open.end()) {
+			function.evaluateBlock(&coords[0][i], 1, &coords[1][0], ny, &coords[2][0], nz, vals.row(i, 0));
+			return;
+		}
+
+		for (size_t j = 0; j < ny; ++j) {
+			// a sample left closed is in no open brick, so the brick of its cell is settled
+			const unsigned char *rowOpen = &open[j * nz];
+			GLfloat *row = vals.row(i, j);
+			size_t cellI = std::min(i, nx - 2) / BRICK;
+			size_t cellJ = std::min(j, ny - 2) / BRICK;
+			for (size_t k = 0; k < nz; ++k) {
+				if (!rowOpen[k]) {
+					row[k] = sides.settled[sides.index(cellI, cellJ, std::min(k, nz - 2) / BRICK)];
+				}
+			}
+
+			// runs of open samples go in one batch, bridging gaps shorter than a
+			// brick to keep the batches long; samples in the gaps get exact values
+			for (size_t k = 0; k < nz;) {
+				if (!rowOpen[k]) {
+					++k;
+					continue;
+				}
+				size_t end = k;
+				size_t gap = 0;
+				for (size_t next = k; next < nz && gap < BRICK; ++next) {
+					gap = rowOpen[next] ? 0 : gap + 1;
+					if (rowOpen[next]) {
+						end = next + 1;
+					}
+				}
+				function.evaluateBlock(&coords[0][i], 1, &coords[1][j], 1, &coords[2][k], end - k, row + k);
+				k = end;
+			}
+		}
+	});
+}
+
+Surface octreeMesh(std::shared_ptr<ImplicitFunc> function, const ExtractionConfig &config, ThreadPool *pool) {
+	GLint nx = config.resolution[0];
+	GLint ny = config.resolution[1];
+	GLint nz = config.resolution[2];
+	if (nx < 2 || ny < 2 || nz < 2) {
+		return genMesh(function, config, pool);
+	}
+
+	EdgeCache vert_dic(nx, ny, nz);
+	std::vector<GLfloat> coords[3] = { config.coordinates(0), config.coordinates(1), config.coordinates(2) };
+	GLfloat* vertexCoord[3] = { &coords[0][0], &coords[1][0], &coords[2][0] };
+
+	// setBorder puts the lattice faces outside, so the bricks on them settled inside are crossed there
+	BrickSides sides = settleBricks(*function, coords, nullptr);
+	for (size_t bi = 0; bi < sides.count[0]; ++bi) {
+		for (size_t bj = 0; bj < sides.count[1]; ++bj) {
+			for (size_t bk = 0; bk < sides.count[2]; ++bk) {
+				bool face = bi == 0 || bj == 0 || bk == 0
+					|| bi + 1 == sides.count[0] || bj + 1 == sides.count[1] || bk + 1 == sides.count[2];
+				size_t n = sides.index(bi, bj, bk);
+				if (config.closeBorder && face && sides.side[n] < 0) {
+					sides.side[n] = 0;
+				}
+			}
+		}
+	}
+
+	ScalarVolume vertexVals(nx, ny, nz);
+	sampleOpenBricks(*function, coords, sides, vertexVals, pool);
+	parallelFor(pool, nx, [&](size_t i) {
+		for (GLint j = 0; j < ny; ++j) {
+			vertexVals.classifyRow(i, j);
+		}
+	});
+
+	// close the surface off at the edges of the box
+	if (config.closeBorder) {
+		vertexVals.setBorder(1000000, false);
+	}
+
+	Surface surface;
+	extractSurface(vertexVals, vertexCoord, vert_dic, pool, surface, nullptr, config.method);
+	return surface;
+}
+
+// funcA is only bounded, and sampled, where the container leaves bricks open or inside
+Surface octreeUnion(std::shared_ptr<ImplicitFunc> funcA, std::shared_ptr<ImplicitFunc> funcB, const ExtractionConfig &config, ThreadPool *pool) {
+	GLint nx = config.resolution[0];
+	GLint ny = config.resolution[1];
+	GLint nz = config.resolution[2];
+	if (nx < 2 || ny < 2 || nz < 2) {
+		return genUnion(funcA, funcB, config, pool);
+	}
+
+	EdgeCache vert_dic(nx, ny, nz);
+	std::vector<GLfloat> coords[3] = { config.coordinates(0), config.coordinates(1), config.coordinates(2) };
+	GLfloat* vertexCoord[3] = { &coords[0][0], &coords[1][0], &coords[2][0] };
+
+	BrickSides containerSides = settleBricks(*funcB, coords, nullptr);
+	BrickSides sides = settleBricks(*funcA, coords, &containerSides);
+
+	ScalarVolume containerVals(nx, ny, nz);
+	sampleOpenBricks(*funcB, coords, containerSides, containerVals, pool);
+	parallelFor(pool, nx, [&](size_t i) {
+		for (GLint j = 0; j < ny; ++j) {
+			containerVals.classifyRow(i, j);
+		}
+	});
+	cacheIntersections(containerVals, vertexCoord, vert_dic, pool);
+
+	ScalarVolume vertexVals(nx, ny, nz);
+	sampleOpenBricks(*funcA, coords, sides, vertexVals, pool);
+	parallelFor(pool, nx, [&](size_t i) {
+		for (GLint j = 0; j < ny; ++j) {
+			intersectRow(vertexVals, i, j, containerVals.row(i, j));
+		}
+	});
+
+	Surface surface;
+	extractSurface(vertexVals, vertexCoord, vert_dic, pool, surface, &containerVals, config.method);
+	return surface;
+}
+
+CachedExtraction::CachedExtraction(std::shared_ptr<ImplicitFunc> funcA, std::shared_ptr<ImplicitFunc> funcB, const ExtractionConfig &config, ThreadPool *pool) {
+	this->funcA = funcA;
+	this->funcB = funcB;
+	this->config = config;
+	this->pool = pool;
+	for (int axis = 0; axis < 3; ++axis) {
+		this->coords[axis] = config.coordinates(axis);
+		this->origin[axis] = 0;
+	}
+	resample();
+}
+
+void CachedExtraction::resample() {
+	GLint nx = config.resolution[0];
+	GLint ny = config.resolution[1];
+	GLint nz = config.resolution[2];
+	rawVals.resize(nx, ny, nz);
+	vertexVals.resize(nx, ny, nz);
+	vert_dic.resize(nx, ny, nz);
+
+	origin[0] = 0;
+	origin[2] = 0;
+	sampleRaw(0, nx, 0, nz);
+
+	// the container does not move, so its intersections are cached once here
+	if (funcB != nullptr) {
+		containerVals.resize(nx, ny, nz);
+		parallelFor(pool, nx, [&](size_t i) {
+			funcB->evaluateBlock(&coords[0][i], 1, &coords[1][0], ny, &coords[2][0], nz, containerVals.row(i, 0));
+			for (GLint j = 0; j < ny; ++j) {
+				containerVals.classifyRow(i, j);
+			}
+		});
+		GLfloat* vertexCoord[3] = { &coords[0][0], &coords[1][0], &coords[2][0] };
+		cacheIntersections(containerVals, vertexCoord, vert_dic, pool);
+	}
+}
+
+// evaluate funcA raw over logical planes [iBegin, iEnd) and columns [kBegin, kEnd)
+// into their places in the ring buffer
+void CachedExtraction::sampleRaw(size_t iBegin, size_t iEnd, size_t kBegin, size_t kEnd) {
+	size_t nx = config.resolution[0];
+	size_t ny = config.resolution[1];
+	size_t nz = config.resolution[2];
+	size_t count = kEnd - kBegin;
+	if (iBegin >= iEnd || count == 0) {
+		return;
+	}
+
+	parallelFor(pool, iEnd - iBegin, [&](size_t n) {
+		size_t i = iBegin + n;
+		std::vector<GLfloat> samples(ny * count);
+		funcA->evaluateRawBlock(&coords[0][i], 1, &coords[1][0], ny, &coords[2][kBegin], count, &samples[0]);
+
+		size_t plane = (i + origin[0]) % nx;
+		for (size_t j = 0; j < ny; ++j) {
+			GLfloat *raw = rawVals.row(plane, j);
+			for (size_t k = 0; k < count; ++k) {
+				raw[(kBegin + k + origin[2]) % nz] = samples[j * count + k];
+			}
+		}
+	});
+}
+
+GLfloat CachedExtraction::cellOffset(int axis) const {
+	GLfloat scale = funcA->offsetScale();
+	return scale != 0 ? config.spacing(axis) / scale : 0;
+}
+
+void CachedExtraction::scrollX(GLfloat inc) {
+	scroll(0, inc);
+}
+
+void CachedExtraction::scrollZ(GLfloat inc) {
+	scroll(2, inc);
+}
+
+void CachedExtraction::scroll(int axis, GLfloat inc) {
+	if (axis == 0) {
+		funcA->incXoff(inc);
+	}
+	else {
+		funcA->incZoff(inc);
+	}
+
+	// the step in cells, which must be whole for the kept samples to line up
+	GLfloat unit = cellOffset(axis);
+	GLfloat cells = unit != 0 ? inc / unit : 0.5f;
+	long step = std::lround(cells);
+	long n = config.resolution[axis];
+	if (std::fabs(cells - step) > 1e-3f || std::labs(step) >= n) {
+		resample();
+		return;
+	}
+
+	// sample (i + step) becomes sample i, so the ring turns by step and the
+	// planes at the end it turned away from are new
+	origin[axis] = (size_t)(((long)origin[axis] + step + n) % n);
+	size_t begin = step > 0 ? n - step : 0;
+	size_t end = step > 0 ? n : -step;
+	if (axis == 0) {
+		sampleRaw(begin, end, 0, config.resolution[2]);
+	}
+	else {
+		sampleRaw(0, config.resolution[0], begin, end);
+	}
+}
+
+Surface CachedExtraction::extract() {
+	GLint nx = config.resolution[0];
+	GLint ny = config.resolution[1];
+	GLint nz = config.resolution[2];
+	GLfloat* vertexCoord[3] = { &coords[0][0], &coords[1][0], &coords[2][0] };
+
+	// unroll the ring at the current level and classify as genMesh and genUnion do,
+	// though from samples already rounded to float
+	GLfloat iso = funcA->getIso();
+	size_t split = nz - origin[2];
+	parallelFor(pool, nx, [&](size_t i) {
+		size_t plane = (i + origin[0]) % nx;
+		for (GLint j = 0; j < ny; ++j) {
+			const GLfloat *raw = rawVals.row(plane, j);
+			GLfloat *values = vertexVals.row(i, j);
+			for (size_t k = 0; k < split; ++k) {
+				values[k] = raw[k + origin[2]] - iso;
+			}
+			for (size_t k = split; k < (size_t)nz; ++k) {
+				values[k] = raw[k - split] - iso;
+			}
+			if (funcB != nullptr) {
+				intersectRow(vertexVals, i, j, containerVals.row(i, j));
+			}
+			else {
+				vertexVals.classifyRow(i, j);
+			}
+		}
+	});
+
+	vert_dic.clearVertices();
+	Surface surface;
+	if (funcB != nullptr) {
+		extractSurface(vertexVals, vertexCoord, vert_dic, pool, surface, &containerVals, config.method);
+	}
+	else {
+		if (config.closeBorder) {
+			vertexVals.setBorder(1000000, false);
+		}
+		extractSurface(vertexVals, vertexCoord, vert_dic, pool, surface, nullptr, config.method);
+	}
+	return surface;
+}
+
+void cacheIntersections(const ScalarVolume &vals, GLfloat* vertex[3], EdgeCache &vert_dic, ThreadPool *pool) {
+	parallelFor(pool, vals.getNx(), [&](size_t i) {
+		for (size_t j = 0; j < vals.getNy(); ++j) {
+			for (size_t k = 0; k < vals.getNz(); ++k) {
+				for (int axis = 0; axis < 3; ++axis) {
+					if (crossesEdge(vals, i, j, k, axis)) {
+						vert_dic.insert(vert_dic.edgeId(i, j, k, axis), edgeIntersection(vals, vertex, i, j, k, axis));
+					}
+				}
+			}
+		}
+	});
+}
+
+void extractSurface(const ScalarVolume &vals, GLfloat* vertex[3], EdgeCache &vert_dic, ThreadPool *pool, Surface &surface,
+	const ScalarVolume *container, ExtractionMethod method) {
+	size_t nx = vals.getNx();
+	size_t ny = vals.getNy();
+	size_t nz = vals.getNz();
+	if (nx < 2 || ny < 2 || nz < 2) {
+		return;
+	}
+	if (method != EXTRACT_MARCHING_CUBES) {
+		extractDualSurface(vals, vertex, vert_dic, pool, surface, container, method == EXTRACT_DUAL_CONTOURING);
+		return;
+	}
+
+	// only bricks holding both inside and outside samples have crossed edges or triangles
+	const size_t BRICK = BrickMap::BRICK;
+	BrickMap bricks(nx, ny, nz);
+	parallelFor(pool, bricks.count(0), [&](size_t bi) {
+		bricks.summarizeSlab(vals, bi);
+	});
+
+	// every slab of lattice points lists the crossed edges it owns, in edge id
+	// order. Rows are compared with the next row along i and j and with themselves
+	// shifted along k; lattice faces have no edge leaving them outward.
+	// The edges leaving a sample lie in the brick of cell (i, j, k), clamped to the lattice
+	std::vector<std::vector<size_t>> slabEdges(nx);
+	parallelFor(pool, nx, [&](size_t i) {
+		size_t bi = std::min(i, nx - 2) / BRICK;
+		for (size_t j = 0; j < ny; ++j) {
+			size_t bj = std::min(j, ny - 2) / BRICK;
+			const unsigned char *here = vals.insideRow(i, j);
+			const unsigned char *nextI = i + 1 < nx ? vals.insideRow(i + 1, j) : nullptr;
+			const unsigned char *nextJ = j + 1 < ny ? vals.insideRow(i, j + 1) : nullptr;
+			for (size_t bk = 0; bk < bricks.count(2); ++bk) {
+				if (!bricks.isCrossed(bi, bj, bk)) {
+					continue;
+				}
+				size_t kEnd = bk + 1 < bricks.count(2) ? (bk + 1) * BRICK : nz;
+				for (size_t k = bk * BRICK; k < kEnd; ++k) {
+					if (nextI != nullptr && here[k] != nextI[k]) {
+						slabEdges[i].push_back(vert_dic.edgeId(i, j, k, 0));
+					}
+					if (nextJ != nullptr && here[k] != nextJ[k]) {
+						slabEdges[i].push_back(vert_dic.edgeId(i, j, k, 1));
+					}
+					if (k + 1 < nz && here[k] != here[k + 1]) {
+						slabEdges[i].push_back(vert_dic.edgeId(i, j, k, 2));
+					}
+				}
+			}
+		}
+	});
+
+	// a prefix sum over the slab sizes gives the first vertex of each slab
+	std::vector<size_t> firstVertex(nx + 1, 0);
+	for (size_t i = 0; i < nx; ++i) {
+		firstVertex[i + 1] = firstVertex[i] + slabEdges[i].size();
+	}
+
+	size_t base = surface.vertexCount();
+	surface.vertices.resize(3 * (base + firstVertex[nx]));
+	surface.normals.resize(surface.vertices.size());
+	parallelFor(pool, nx, [&](size_t i) {
+		const std::vector<size_t> &edges = slabEdges[i];
+		for (size_t n = 0; n < edges.size(); ++n) {
+			size_t sample = edges[n] / 3;
+			int axis = (int)(edges[n] % 3);
+			size_t j = sample % vals.strideI() / vals.strideJ();
+			size_t k = sample % vals.strideJ();
+
+			// cached intersections lie on the container, so take their normals from it
+			GLfloat intersection;
+			const ScalarVolume *field = &vals;
+			if (vert_dic.lookup(edges[n], intersection)) {
+				field = container != nullptr ? container : &vals;
+			}
+			else {
+				intersection = edgeIntersection(vals, vertex, i, j, k, axis);
+			}
+
+			GLuint vertexId = (GLuint)(base + firstVertex[i] + n);
+			GLfloat *point = &surface.vertices[3 * vertexId];
+			point[0] = vertex[0][i];
+			point[1] = vertex[1][j];
+			point[2] = vertex[2][k];
+			point[axis] = intersection;
+			edgeNormal(*field, vertex, i, j, k, axis, intersection, &surface.normals[3 * vertexId]);
+			vert_dic.insertVertex(edges[n], vertexId);
+		}
+	});
+
+	// triangulate each slab of cells into its own buffer
+	std::vector<std::vector<GLuint>> slabIndices(nx - 1);
+	parallelFor(pool, nx - 1, [&](size_t i) {
+		for (size_t j = 0; j < ny - 1; ++j) {
+			for (size_t bk = 0; bk < bricks.count(2); ++bk) {
+				if (!bricks.isCrossed(i / BRICK, j / BRICK, bk)) {
+					continue;
+				}
+				size_t kEnd = std::min((bk + 1) * BRICK, nz - 1);
+				for (size_t k = bk * BRICK; k < kEnd; ++k) {
+					int index = vals.cubeIndex(i, j, k);
+					findVerts(i, j, k, index, vert_dic, slabIndices[i]);
+				}
+			}
+		}
+	});
+
+	// and scatter the buffers to offsets from a prefix sum over their sizes,
+	// which keeps the serial triangle order whatever the thread count
+	std::vector<size_t> firstIndex(nx, 0);
+	for (size_t i = 0; i < nx - 1; ++i) {
+		firstIndex[i + 1] = firstIndex[i] + slabIndices[i].size();
+	}
+
+	size_t indexBase = surface.indices.size();
+	surface.indices.resize(indexBase + firstIndex[nx - 1]);
+	parallelFor(pool, nx - 1, [&](size_t i) {
+		std::copy(slabIndices[i].begin(), slabIndices[i].end(), surface.indices.begin() + indexBase + firstIndex[i]);
+	});
+}
+
+// sample lattice plane i into slice local of the streaming windows
+typedef std::function<void(size_t i, size_t local)> SliceSampler;
+
+// two-slice marching cubes over the lattice of config. vals (and container for
+// a union) hold slices i and i + 1, vert_dic holds the edges of planes i - 1 and i.
+// Vertices are numbered in edge id order, the same as extractSurface.
+static void streamSurface(const ExtractionConfig &config, ScalarVolume &vals, ScalarVolume *container,
+	const SliceSampler &sample, const SlabCallback &onSlab, ImplicitFunc &function, ImplicitFunc *containerFunc) {
+	size_t nx = config.resolution[0];
+	size_t ny = config.resolution[1];
+	size_t nz = config.resolution[2];
+	if (nx < 2 || ny < 2 || nz < 2) {
+		return;
+	}
+
+	std::vector<GLfloat> coords[3] = { config.coordinates(0), config.coordinates(1), config.coordinates(2) };
+	EdgeCache vert_dic(2, ny, nz);
+	std::vector<int> cubeIndices((ny - 1) * (nz - 1));
+	Surface chunk;
+	size_t vertexCount = 0;
+	size_t firstVertex = 0;
+
+	sample(0, 0);
+	for (size_t t = 0; t < nx; ++t) {
+		if (t + 1 < nx) {
+			sample(t + 1, 1);
+		}
+
+		// the edges of plane t - 1 move down, plane t goes in slice 1
+		vert_dic.copySlice(1, 0);
+		vert_dic.clearSlice(1);
+
+		GLfloat* local[3] = { &coords[0][t], &coords[1][0], &coords[2][0] };
+		for (size_t j = 0; j < ny; ++j) {
+			for (size_t k = 0; k < nz; ++k) {
+				for (int axis = 0; axis < 3; ++axis) {
+					// slice 1 is stale once the last plane has been sampled
+					if ((axis == 0 && t + 1 == nx) || !crossesEdge(vals, 0, j, k, axis)) {
+						continue;
+					}
+
+					GLfloat intersection;
+					ImplicitFunc *field = &function;
+					if (container != nullptr && crossesEdge(*container, 0, j, k, axis)) {
+						intersection = edgeIntersection(*container, local, 0, j, k, axis);
+						field = containerFunc;
+					}
+					else {
+						intersection = edgeIntersection(vals, local, 0, j, k, axis);
+					}
+
+					// the window is too thin for central differences along i,
+					// so normals come from the function's own gradient
+					GLfloat point[3] = { local[0][0], local[1][j], local[2][k] };
+					point[axis] = intersection;
+					GLfloat normal[3];
+					field->gradient(point[0], point[1], point[2], normal);
+					toNormal(normal);
+					chunk.vertices.insert(chunk.vertices.end(), point, point + 3);
+					chunk.normals.insert(chunk.normals.end(), normal, normal + 3);
+					vert_dic.insertVertex(vert_dic.edgeId(1, j, k, axis), (GLuint)vertexCount++);
+				}
+			}
+		}
+
+		// every edge of slab t - 1 is now numbered
+		if (t > 0) {
+			for (size_t j = 0; j < ny - 1; ++j) {
+				for (size_t k = 0; k < nz - 1; ++k) {
+					findVerts(0, j, k, cubeIndices[j * (nz - 1) + k], vert_dic, chunk.indices);
+				}
+			}
+			onSlab(chunk, firstVertex);
+			firstVertex = vertexCount;
+			chunk.vertices.clear();
+			chunk.normals.clear();
+			chunk.indices.clear();
+		}
+
+		if (t + 1 < nx) {
+			for (size_t j = 0; j < ny - 1; ++j) {
+				for (size_t k = 0; k < nz - 1; ++k) {
+					cubeIndices[j * (nz - 1) + k] = vals.cubeIndex(0, j, k);
+				}
+			}
+			vals.copySlice(1, 0);
+			if (container != nullptr) {
+				container->copySlice(1, 0);
+			}
+		}
+	}
+}
+
+void streamMesh(std::shared_ptr<ImplicitFunc> function, const ExtractionConfig &config, const SlabCallback &onSlab, ThreadPool *pool) {
+	GLint nx = config.resolution[0];
+	GLint ny = config.resolution[1];
+	GLint nz = config.resolution[2];
+	std::vector<GLfloat> coords[3] = { config.coordinates(0), config.coordinates(1), config.coordinates(2) };
+
+	ScalarVolume vertexVals(2, ny, nz);
+	streamSurface(config, vertexVals, nullptr, [&](size_t i, size_t local) {
+		// close the surface off at the edges of the box
+		bool edgePlane = i == 0 || i == (size_t)nx - 1;
+		parallelFor(pool, ny, [&](size_t j) {
+			if (!config.closeBorder) {
+				function->evaluateBlock(&coords[0][i], 1, &coords[1][j], 1, &coords[2][0], nz, vertexVals.row(local, j));
+				vertexVals.classifyRow(local, j);
+				return;
+			}
+			if (edgePlane || j == 0 || j == (size_t)ny - 1) {
+				for (GLint k = 0; k < nz; ++k) {
+					vertexVals.setSample(local, j, k, 1000000, false);
+				}
+				return;
+			}
+			function->evaluateBlock(&coords[0][i], 1, &coords[1][j], 1, &coords[2][1], nz - 2, vertexVals.row(local, j) + 1);
+			vertexVals.setSample(local, j, 0, 1000000, false);
+			vertexVals.setSample(local, j, nz - 1, 1000000, false);
+			vertexVals.classifyRow(local, j);
+		});
+	}, onSlab, *function, nullptr);
+}
+
+void streamUnion(std::shared_ptr<ImplicitFunc> funcA, std::shared_ptr<ImplicitFunc> funcB, const ExtractionConfig &config, const SlabCallback &onSlab, ThreadPool *pool) {
+	GLint ny = config.resolution[1];
+	GLint nz = config.resolution[2];
+	std::vector<GLfloat> coords[3] = { config.coordinates(0), config.coordinates(1), config.coordinates(2) };
+
+	ScalarVolume vertexVals(2, ny, nz);
+	ScalarVolume containerVals(2, ny, nz);
+	streamSurface(config, vertexVals, &containerVals, [&](size_t i, size_t local) {
+		parallelFor(pool, ny, [&](size_t j) {
+			funcB->evaluateBlock(&coords[0][i], 1, &coords[1][j], 1, &coords[2][0], nz, containerVals.row(local, j));
+			funcA->evaluateBlock(&coords[0][i], 1, &coords[1][j], 1, &coords[2][0], nz, vertexVals.row(local, j));
+			containerVals.classifyRow(local, j);
+			intersectRow(vertexVals, local, j, containerVals.row(local, j));
+		});
+	}, onSlab, *funcA, funcB.get());
+}
+
+// every crossed edge had its vertex numbered in the pass before, so a corner
+// missing from vert_dic is a bug. Its triangle is then left out whole, so
+// that the triangles after it keep their corners
+void findVerts(size_t i, size_t j, size_t k, int index, const EdgeCache &vert_dic, std::vector<GLuint> &indices) {
+	GLuint triangle[3];
+
+	for (int e = 0; e < 13; e += 3) {
+		if (aCases[index][e] == -1) {
+			return;
+		}
+
+		bool complete = true;
+		for (int corner = 0; corner < 3; ++corner) {
+			int edgeNum = aCases[index][e + corner];
+			// lower end of the edge and the axis it runs along
+			size_t edge = vert_dic.edgeId(i + aEdges[edgeNum][0], j + aEdges[edgeNum][1], k + aEdges[edgeNum][2], aEdges[edgeNum][3]);
+			complete = vert_dic.lookupVertex(edge, triangle[corner]) && complete;
+		}
+		assert(complete);
+		if (complete) {
+			indices.insert(indices.end(), triangle, triangle + 3);
+		}
+	}
+}
+
+bool isBetween(GLfloat val, GLfloat a, GLfloat b) {
+	if (a > b) {
+		return val >= b && val <= a;
+	}
+	else {
+		return val >= a && val <= b;
+	}
+}
+
+GLfloat interpolate(GLfloat a, GLfloat aVal, GLfloat b, GLfloat bVal) {
+	GLfloat val = a + ((0 - aVal) * (b - a) / (bVal - aVal));
+	if (isBetween(val, a, b)) {
+		return val;
+	}
+	else {
+		return a;
+	}
+}
@@ -0,0 +1,111 @@
+#include <functional>
+#include <memory>
+#include "ImplicitFunc.h"
+#include "Surface.h"
+#include "ExtractionConfig.h"
+#include "ScalarVolume.h"
+#include "EdgeCache.h"
+
+#ifndef MARCHINGCUBES_H
+#define MARCHINGCUBES_H
+
+class ThreadPool;
+
+// marching cubes over the lattice described by config
+// the field is sampled and meshed on pool when one is given, otherwise on the calling thread
+Surface genMesh(std::shared_ptr<ImplicitFunc> function, const ExtractionConfig &config, ThreadPool *pool = nullptr);
+
+// surface of funcA clipped to the inside of the container funcB
+Surface genUnion(std::shared_ptr<ImplicitFunc> funcA, std::shared_ptr<ImplicitFunc> funcB, const ExtractionConfig &config, ThreadPool *pool = nullptr);
+
+// genMesh and genUnion, sampling only where the fields' bounds leave the surface
+// possible. The lattice is split into an octree over its bricks of
+// BrickMap::BRICK^3 cells; a node whose bounds settle which side of the surface
+// it is on takes a value of that side, and the rest are split down to single
+// bricks. Those bricks are sampled, along with one more sample around them for
+// the normals, so the surface is the same as the batch extractors give.
+Surface octreeMesh(std::shared_ptr<ImplicitFunc> function, const ExtractionConfig &config, ThreadPool *pool = nullptr);
+Surface octreeUnion(std::shared_ptr<ImplicitFunc> funcA, std::shared_ptr<ImplicitFunc> funcB, const ExtractionConfig &config, ThreadPool *pool = nullptr);
+
+// receives the vertices and triangles finished by each slab of cells.
+// indices are global: the first vertex in chunk has number firstVertex
+typedef std::function<void(const Surface &chunk, size_t firstVertex)> SlabCallback;
+
+// genMesh and genUnion sampled one i-slice at a time. Only two slices of
+// samples and two of edges are kept, so memory grows with ny * nz, and each
+// slab is handed to onSlab as soon as its triangles are done. Concatenating
+// the chunks gives the same surface as the batch extractors.
+void streamMesh(std::shared_ptr<ImplicitFunc> function, const ExtractionConfig &config, const SlabCallback &onSlab, ThreadPool *pool = nullptr);
+void streamUnion(std::shared_ptr<ImplicitFunc> funcA, std::shared_ptr<ImplicitFunc> funcB, const ExtractionConfig &config, const SlabCallback &onSlab, ThreadPool *pool = nullptr);
+
+// The samples of genMesh (funcB null) or genUnion kept between extractions.
+// funcA is sampled raw, so when only its iso level moves, extract reclassifies
+// the kept samples and remeshes without evaluating either field again.
+// Its samples sit in a ring buffer along x and z: scrolling funcA by whole
+// lattice cells only samples the planes that come into view.
+// The raw samples are rounded to float before the level is taken off, where
+// the batch extractors take it off in double, so the rare sample within
+// rounding of the level can land on the other side of it. The surface is
+// then not quite theirs: at resolution 60 the startup union has 43454
+// triangles here against genUnion's 43450.
+class CachedExtraction {
+public:
+	CachedExtraction(std::shared_ptr<ImplicitFunc> funcA, std::shared_ptr<ImplicitFunc> funcB, const ExtractionConfig &config, ThreadPool *pool = nullptr);
+
+	// sample both fields again, after they change other than in funcA's iso
+	void resample();
+
+	// funcA->incXoff(inc) or incZoff(inc). A step of whole cells rolls the ring
+	// buffer and samples the new planes; any other step samples everything again
+	void scrollX(GLfloat inc);
+	void scrollZ(GLfloat inc);
+
+	// the offset that moves funcA by one lattice cell along axis, or 0 when it has no offsets
+	GLfloat cellOffset(int axis) const;
+
+	// surface at funcA's current iso level
+	Surface extract();
+
+private:
+	std::shared_ptr<ImplicitFunc> funcA;
+	std::shared_ptr<ImplicitFunc> funcB;
+	ExtractionConfig config;
+	ThreadPool *pool;
+
+	std::vector<GLfloat> coords[3];
+	// logical sample (i, j, k) of funcA is stored at ((i + origin[0]) % nx, j, (k + origin[2]) % nz)
+	ScalarVolume rawVals;
+	size_t origin[3];
+	ScalarVolume containerVals;
+	ScalarVolume vertexVals;
+	EdgeCache vert_dic;
+
+	void scroll(int axis, GLfloat inc);
+	void sampleRaw(size_t iBegin, size_t iEnd, size_t kBegin, size_t kEnd);
+};
+
+// cache the intersection of every edge of vals that joins an inside and an outside sample
+void cacheIntersections(const ScalarVolume &vals, GLfloat* vertex[3], EdgeCache &vert_dic, ThreadPool *pool);
+
+// append the surface of vals to surface. One vertex is made per crossed edge,
+// using the intersection already in vert_dic when there is one. Normals are
+// central differences of vals, or of container for the cached intersections.
+// Slabs of vertices and triangles are built independently and merged at
+// prefix-sum offsets, so the result does not depend on the number of threads in pool.
+// The dual methods hand over to extractDualSurface.
+void extractSurface(const ScalarVolume &vals, GLfloat* vertex[3], EdgeCache &vert_dic, ThreadPool *pool, Surface &surface,
+	const ScalarVolume *container = nullptr, ExtractionMethod method = EXTRACT_MARCHING_CUBES);
+
+// where the surface crosses the edge from (i, j, k) along axis, by the values at its ends
+GLfloat edgeIntersection(const ScalarVolume &vals, GLfloat* vertex[3], size_t i, size_t j, size_t k, int axis);
+
+// unit normal there, from the central differences of vals
+void edgeNormal(const ScalarVolume &vals, GLfloat* vertex[3], size_t i, size_t j, size_t k, int axis,
+	GLfloat intersection, GLfloat normal[3]);
+
+// append the triangles of cell (i, j, k) using the vertices numbered in vert_dic
+void findVerts(size_t i, size_t j, size_t k, int index, const EdgeCache &vert_dic, std::vector<GLuint> &indices);
+
+GLfloat interpolate(GLfloat a, GLfloat aVal, GLfloat b, GLfloat bVal);
+
+#endif
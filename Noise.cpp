@@ -1,4 +1,6 @@
 #include "Noise.h"
+#include "NoiseSIMD.h"
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
@@ -82,6 +84,203 @@ double Noise::noise(double x, double y, double z) {
 	return (lerp(y1, y2, w) + 1) / 2;
 }
 
+void Noise::noise(const double *x, const double *y, const double *z, double *out, size_t count) {
+	// the kernels do not wrap coordinates, so repeating noise stays scalar
+	size_t n = repeat > 0 ? 0 : noiseSIMD(p, x, y, z, out, count);
+	for (; n < count; ++n) {
+		out[n] = noise(x[n], y[n], z[n]);
+	}
+}
+
+// the lattice gradient grad() dots with the offset to its corner
+static void gradVector(int hash, double g[3]) {
+	int h = hash & 0xF;
+	g[0] = g[1] = g[2] = 0;
+	g[h < 8 ? 0 : 1] += (h & 1) ? -1 : 1;
+	g[h < 4 ? 1 : (h == 12 || h == 14 ? 0 : 2)] += (h & 2) ? -1 : 1;
+}
+
+double Noise::noiseWithGradient(double x, double y, double z, double grad[3]) {
+	if (repeat > 0) {
+		x = std::fmod(x, repeat);
+		y = std::fmod(y, repeat);
+		z = std::fmod(z, repeat);
+	}
+
+	int xi = (int)x & 255;
+	int yi = (int)y & 255;
+	int zi = (int)z & 255;
+	double xf = x - (int)x;
+	double yf = y - (int)y;
+	double zf = z - (int)z;
+	double u = fade(xf);
+	double v = fade(yf);
+	double w = fade(zf);
+
+	// corners in the order aaa, baa, aba, bba, aab, bab, abb, bbb
+	int hash[8];
+	hash[0] = p[p[p[xi] + yi] + zi];
+	hash[1] = p[p[p[inc(xi)] + yi] + zi];
+	hash[2] = p[p[p[xi] + inc(yi)] + zi];
+	hash[3] = p[p[p[inc(xi)] + inc(yi)] + zi];
+	hash[4] = p[p[p[xi] + yi] + inc(zi)];
+	hash[5] = p[p[p[inc(xi)] + yi] + inc(zi)];
+	hash[6] = p[p[p[xi] + inc(yi)] + inc(zi)];
+	hash[7] = p[p[p[inc(xi)] + inc(yi)] + inc(zi)];
+
+	double g[8];
+	double vec[8][3];
+	for (int c = 0; c < 8; ++c) {
+		double dx = (c & 1) ? xf - 1 : xf;
+		double dy = (c & 2) ? yf - 1 : yf;
+		double dz = (c & 4) ? zf - 1 : zf;
+		g[c] = this->grad(hash[c], dx, dy, dz);
+		gradVector(hash[c], vec[c]);
+	}
+
+	// the value exactly as noise() interpolates it
+	double x1, x2, y1, y2;
+	x1 = lerp(g[0], g[1], u);
+	x2 = lerp(g[2], g[3], u);
+	y1 = lerp(x1, x2, v);
+	x1 = lerp(g[4], g[5], u);
+	x2 = lerp(g[6], g[7], u);
+	y2 = lerp(x1, x2, v);
+	double value = (lerp(y1, y2, w) + 1) / 2;
+
+	// n = k0 + k1 u + k2 v + k3 w + k4 uv + k5 vw + k6 uw + k7 uvw; each corner
+	// term also changes with position through its own gradient vector
+	double k1 = g[1] - g[0];
+	double k2 = g[2] - g[0];
+	double k3 = g[4] - g[0];
+	double k4 = g[0] - g[1] - g[2] + g[3];
+	double k5 = g[0] - g[2] - g[4] + g[6];
+	double k6 = g[0] - g[1] - g[4] + g[5];
+	double k7 = -g[0] + g[1] + g[2] - g[3] + g[4] - g[5] - g[6] + g[7];
+	double du = fadeDerivative(xf);
+	double dv = fadeDerivative(yf);
+	double dw = fadeDerivative(zf);
+	double slope[3] = {
+		du * (k1 + k4 * v + k6 * w + k7 * v * w),
+		dv * (k2 + k4 * u + k5 * w + k7 * u * w),
+		dw * (k3 + k5 * v + k6 * u + k7 * u * v)
+	};
+
+	for (int axis = 0; axis < 3; ++axis) {
+		double a1 = lerp(vec[0][axis], vec[1][axis], u);
+		double a2 = lerp(vec[2][axis], vec[3][axis], u);
+		double b1 = lerp(vec[4][axis], vec[5][axis], u);
+		double b2 = lerp(vec[6][axis], vec[7][axis], u);
+		double blend = lerp(lerp(a1, a2, v), lerp(b1, b2, v), w);
+		grad[axis] = (blend + slope[axis]) / 2;
+	}
+	return value;
+}
+
+// range of lerp(a, b, t) for a in [aLo, aHi], b in [bLo, bHi] and t in [tLo, tHi]
+// within [0, 1]. At each t it is a weighted mean, with bounds linear in t
+static void lerpBounds(double aLo, double aHi, double bLo, double bHi, double tLo, double tHi, double &lo, double &hi) {
+	lo = std::min(aLo + tLo * (bLo - aLo), aLo + tHi * (bLo - aLo));
+	hi = std::max(aHi + tLo * (bHi - aHi), aHi + tHi * (bHi - aHi));
+}
+
+// past this many cells the bounds approach the whole range of the noise anyway
+static const int MAX_BOUND_CELLS = 8;
+
+bool Noise::noiseBounds(const double lo[3], const double hi[3], double &min, double &max) {
+	if (repeat > 0 || lo[0] < 0 || lo[1] < 0 || lo[2] < 0) {
+		return false;
+	}
+	int first[3], last[3];
+	for (int axis = 0; axis < 3; ++axis) {
+		first[axis] = (int)lo[axis];
+		last[axis] = (int)hi[axis];
+	}
+	if ((last[0] - first[0] + 1) * (last[1] - first[1] + 1) * (last[2] - first[2] + 1) > MAX_BOUND_CELLS) {
+		return false;
+	}
+
+	double low = HUGE_VAL;
+	double high = -HUGE_VAL;
+	for (int cx = first[0]; cx <= last[0]; ++cx) {
+		for (int cy = first[1]; cy <= last[1]; ++cy) {
+			for (int cz = first[2]; cz <= last[2]; ++cz) {
+				// the part of the box in this cell, as offsets from its lower corner
+				int cell[3] = { cx, cy, cz };
+				double fLo[3], fHi[3], tLo[3], tHi[3];
+				for (int axis = 0; axis < 3; ++axis) {
+					fLo[axis] = std::max(lo[axis] - cell[axis], 0.0);
+					fHi[axis] = std::min(hi[axis] - cell[axis], 1.0);
+					tLo[axis] = fade(fLo[axis]);
+					tHi[axis] = fade(fHi[axis]);
+				}
+
+				// each corner term is linear in the offset, so its range is at the box ends.
+				// Corners in the order aaa, baa, aba, bba, aab, bab, abb, bbb
+				int xi = cx & 255;
+				int yi = cy & 255;
+				int zi = cz & 255;
+				double gLo[8], gHi[8];
+				for (int c = 0; c < 8; ++c) {
+					int hash = p[p[p[(c & 1) ? inc(xi) : xi] + ((c & 2) ? inc(yi) : yi)] + ((c & 4) ? inc(zi) : zi)];
+					double vec[3];
+					gradVector(hash, vec);
+					gLo[c] = gHi[c] = 0;
+					for (int axis = 0; axis < 3; ++axis) {
+						double corner = (c >> axis) & 1;
+						double a = vec[axis] * (fLo[axis] - corner);
+						double b = vec[axis] * (fHi[axis] - corner);
+						gLo[c] += std::min(a, b);
+						gHi[c] += std::max(a, b);
+					}
+				}
+
+				// and the interpolation of noise() carried out on the ranges
+				double x1Lo, x1Hi, x2Lo, x2Hi, y1Lo, y1Hi, y2Lo, y2Hi, nLo, nHi;
+				lerpBounds(gLo[0], gHi[0], gLo[1], gHi[1], tLo[0], tHi[0], x1Lo, x1Hi);
+				lerpBounds(gLo[2], gHi[2], gLo[3], gHi[3], tLo[0], tHi[0], x2Lo, x2Hi);
+				lerpBounds(x1Lo, x1Hi, x2Lo, x2Hi, tLo[1], tHi[1], y1Lo, y1Hi);
+				lerpBounds(gLo[4], gHi[4], gLo[5], gHi[5], tLo[0], tHi[0], x1Lo, x1Hi);
+				lerpBounds(gLo[6], gHi[6], gLo[7], gHi[7], tLo[0], tHi[0], x2Lo, x2Hi);
+				lerpBounds(x1Lo, x1Hi, x2Lo, x2Hi, tLo[1], tHi[1], y2Lo, y2Hi);
+				lerpBounds(y1Lo, y1Hi, y2Lo, y2Hi, tLo[2], tHi[2], nLo, nHi);
+				low = std::min(low, nLo);
+				high = std::max(high, nHi);
+			}
+		}
+	}
+
+	// with room for the rounding of noise() itself
+	min = (low + 1) / 2 - 1e-12;
+	max = (high + 1) / 2 + 1e-12;
+	return true;
+}
+
+double Noise::octaveWithGradient(double x, double y, double z, int octaves, double persistence, double grad[3]) {
+	double total = 0;
+	double frequency = 1;
+	double amplitude = 1;
+	double maxValue = 0;
+	grad[0] = grad[1] = grad[2] = 0;
+	for (int i = 0;i<octaves;i++) {
+		double g[3];
+		total += noiseWithGradient(x * frequency, y * frequency, z * frequency, g) * amplitude;
+		for (int axis = 0; axis < 3; ++axis) {
+			grad[axis] += g[axis] * amplitude * frequency;
+		}
+
+		maxValue += amplitude;
+
+		amplitude *= persistence;
+		frequency *= 2;
+	}
+
+	for (int axis = 0; axis < 3; ++axis) {
+		grad[axis] /= maxValue;
+	}
+	return total / maxValue;
+}
+
 int Noise::inc(int num) {
 	num++;
 	if (repeat > 0) num = std::fmod(num, repeat);
@@ -115,6 +314,10 @@ double Noise::fade(double t) {
 	return t * t * t * (t * (t * 6 - 15) + 10);      // 6t^5 - 15t^4 + 10t^3
 }
 
+double Noise::fadeDerivative(double t) {
+	return 30 * t * t * (t * (t - 2) + 1);      // 30t^4 - 60t^3 + 30t^2
+}
+
 double Noise::lerp(double a, double b, double x) {
 	return a + x * (b - a);
 }
\ No newline at end of file
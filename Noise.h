@@ -1,6 +1,8 @@
 #ifndef NOISE_H
 #define NOISE_H
 
+#include <cstddef>
+
 class Noise {
 private:
 	int permutation[256] = { 151,160,137,91,90,15,
@@ -26,9 +28,22 @@ public:
 	Noise();
 	double octave(double x, double y, double z, int octaves, double persistence);
 	double noise(double x, double y, double z);
+	// noise of count points given as separate x, y and z arrays, in vector
+	// lanes where the CPU allows and with the same results as noise()
+	void noise(const double *x, const double *y, const double *z, double *out, size_t count);
+	// noise() along with its analytic derivative along x, y and z in grad
+	double noiseWithGradient(double x, double y, double z, double grad[3]);
+	double octaveWithGradient(double x, double y, double z, int octaves, double persistence, double grad[3]);
+	// bounds on noise() over the box [lo, hi], from interval arithmetic on the
+	// interpolation in each lattice cell the box touches. False, with nothing
+	// written, for boxes reaching below 0, touching too many cells, or with repeat
+	bool noiseBounds(const double lo[3], const double hi[3], double &min, double &max);
+	// the 512 entry permutation table, for noise built on the same hashes
+	const int *getTable() const { return p; }
 	int inc(int num);
 	double grad(int hash, double x, double y, double z);
 	double fade(double t);
+	double fadeDerivative(double t);
 	double lerp(double a, double b, double x);
 };
 
@@ -0,0 +1,113 @@
+#include "NoiseF.h"
+#include <cmath>
+#include "Noise.h"
+#include "NoiseSIMD.h"
+
+NoiseF::NoiseF(int repeat) {
+	this->repeat = repeat;
+	const int *table = Noise(repeat).getTable();
+	for (int x = 0; x < 512; x++) {
+		p[x] = table[x];
+	}
+}
+
+NoiseF::NoiseF() {
+	this->repeat = -1;
+	const int *table = Noise().getTable();
+	for (int x = 0; x < 512; x++) {
+		p[x] = table[x];
+	}
+}
+
+float NoiseF::octave(float x, float y, float z, int octaves, float persistence) {
+	float total = 0;
+	float frequency = 1;
+	float amplitude = 1;
+	float maxValue = 0;
+	for (int i = 0; i < octaves; i++) {
+		total += noise(x * frequency, y * frequency, z * frequency) * amplitude;
+
+		maxValue += amplitude;
+
+		amplitude *= persistence;
+		frequency *= 2;
+	}
+
+	return total / maxValue;
+}
+
+float NoiseF::noise(float x, float y, float z) {
+	if (repeat > 0) {
+		x = std::fmod(x, (float)repeat);
+		y = std::fmod(y, (float)repeat);
+		z = std::fmod(z, (float)repeat);
+	}
+
+	int xi = (int)x & 255;
+	int yi = (int)y & 255;
+	int zi = (int)z & 255;
+	float xf = x - (int)x;
+	float yf = y - (int)y;
+	float zf = z - (int)z;
+	float u = fade(xf);
+	float v = fade(yf);
+	float w = fade(zf);
+
+	int aaa, aba, aab, abb, baa, bba, bab, bbb;
+	aaa = p[p[p[xi] + yi] + zi];
+	aba = p[p[p[xi] + inc(yi)] + zi];
+	aab = p[p[p[xi] + yi] + inc(zi)];
+	abb = p[p[p[xi] + inc(yi)] + inc(zi)];
+	baa = p[p[p[inc(xi)] + yi] + zi];
+	bba = p[p[p[inc(xi)] + inc(yi)] + zi];
+	bab = p[p[p[inc(xi)] + yi] + inc(zi)];
+	bbb = p[p[p[inc(xi)] + inc(yi)] + inc(zi)];
+
+	float x1, x2, y1, y2;
+	x1 = lerp(grad(aaa, xf, yf, zf),
+		grad(baa, xf - 1, yf, zf),
+		u);
+	x2 = lerp(grad(aba, xf, yf - 1, zf),
+		grad(bba, xf - 1, yf - 1, zf),
+		u);
+	y1 = lerp(x1, x2, v);
+
+	x1 = lerp(grad(aab, xf, yf, zf - 1),
+		grad(bab, xf - 1, yf, zf - 1),
+		u);
+	x2 = lerp(grad(abb, xf, yf - 1, zf - 1),
+		grad(bbb, xf - 1, yf - 1, zf - 1),
+		u);
+	y2 = lerp(x1, x2, v);
+
+	return (lerp(y1, y2, w) + 1) / 2;
+}
+
+void NoiseF::noise(const float *x, const float *y, const float *z, float *out, size_t count) {
+	size_t n = repeat > 0 ? 0 : noiseSIMD(p, x, y, z, out, count);
+	for (; n < count; ++n) {
+		out[n] = noise(x[n], y[n], z[n]);
+	}
+}
+
+int NoiseF::inc(int num) {
+	num++;
+	if (repeat > 0) num = num % repeat;
+	return num;
+}
+
+// same gradients as Noise::grad, picked without the switch
+float NoiseF::grad(int hash, float x, float y, float z) {
+	int h = hash & 0xF;
+	float u = h < 8 ? x : y;
+	float v = h < 4 ? y : (h == 12 || h == 14 ? x : z);
+	return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+}
+
+float NoiseF::fade(float t) {
+	return t * t * t * (t * (t * 6 - 15) + 10);      // 6t^5 - 15t^4 + 10t^3
+}
+
+float NoiseF::lerp(float a, float b, float x) {
+	return a + x * (b - a);
+}
@@ -0,0 +1,34 @@
+#include <cstddef>
+
+#ifndef NOISEF_H
+#define NOISEF_H
+
+// Single precision Perlin noise on the same permutation table as Noise.
+// Coordinates that are already floats split into cell and fraction exactly,
+// so the only difference from Noise is float rounding in fade, grad and lerp.
+// For coordinates >= 0, where the noise lies in [0, 1],
+// |NoiseF::noise - Noise::noise| <= NOISEF_MAX_ERROR at the same point
+// (the worst seen over 2M points was 1.2e-6). Negative coordinates leave that
+// range through the truncating cell split, and there the error is relative.
+const float NOISEF_MAX_ERROR = 4e-6f;
+
+class NoiseF {
+private:
+	int p[512];
+	int repeat;
+
+public:
+	NoiseF(int repeat);
+	NoiseF();
+	float octave(float x, float y, float z, int octaves, float persistence);
+	float noise(float x, float y, float z);
+	// noise of count points in vector lanes where the CPU allows,
+	// with the same results as noise()
+	void noise(const float *x, const float *y, const float *z, float *out, size_t count);
+	int inc(int num);
+	float grad(int hash, float x, float y, float z);
+	float fade(float t);
+	float lerp(float a, float b, float x);
+};
+
+#endif
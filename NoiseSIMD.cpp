@@ -0,0 +1,1025 @@
+#include "NoiseSIMD.h"
+#include <atomic>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define NOISE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// GCC and Clang only emit an instruction set inside functions marked for it;
+// MSVC accepts the intrinsics anywhere
+#if defined(_MSC_VER) && !defined(__clang__)
+#define NOISE_TARGET(isa)
+#else
+#define NOISE_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+// AVX-512F has fused multiply-add, which GCC would otherwise use for a
+// multiply followed by an add. Each has to round on its own like the scalar code.
+#if defined(__clang__)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+#ifdef NOISE_X86
+
+static void cpuid(int leaf, int subleaf, int regs[4]) {
+#ifdef _MSC_VER
+	__cpuidex(regs, leaf, subleaf);
+#else
+	unsigned int a, b, c, d;
+	__cpuid_count(leaf, subleaf, a, b, c, d);
+	regs[0] = a;
+	regs[1] = b;
+	regs[2] = c;
+	regs[3] = d;
+#endif
+}
+
+// register state the OS saves on a context switch
+static unsigned long long xgetbv0() {
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	unsigned int lo, hi;
+	__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((unsigned long long)hi << 32) | lo;
+#endif
+}
+
+SimdLevel detectSimdLevel() {
+	int regs[4];
+	cpuid(0, 0, regs);
+	int maxLeaf = regs[0];
+
+	cpuid(1, 0, regs);
+	if ((regs[3] & (1 << 26)) == 0) {
+		return SIMD_SCALAR;
+	}
+
+	// AVX needs the OS to save the ymm registers, AVX-512 the zmm and mask ones too
+	bool osxsave = (regs[2] & (1 << 27)) != 0;
+	bool avx = (regs[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || maxLeaf < 7) {
+		return SIMD_SSE2;
+	}
+	unsigned long long xcr0 = xgetbv0();
+	if ((xcr0 & 0x6) != 0x6) {
+		return SIMD_SSE2;
+	}
+
+	cpuid(7, 0, regs);
+	bool avx2 = (regs[1] & (1 << 5)) != 0;
+	bool avx512f = (regs[1] & (1 << 16)) != 0;
+	if (avx512f && (xcr0 & 0xE6) == 0xE6) {
+		return SIMD_AVX512;
+	}
+	return avx2 ? SIMD_AVX2 : SIMD_SSE2;
+}
+
+// x - (int)x for two lanes, with (int)x & 255 in the low two ints of cell
+NOISE_TARGET("sse2") static inline __m128d splitSSE2(__m128d v, __m128i &cell) {
+	__m128i t = _mm_cvttpd_epi32(v);
+	cell = _mm_and_si128(t, _mm_set1_epi32(255));
+	return _mm_sub_pd(v, _mm_cvtepi32_pd(t));
+}
+
+NOISE_TARGET("sse2") static inline __m128d fadeSSE2(__m128d t) {
+	__m128d t3 = _mm_mul_pd(_mm_mul_pd(t, t), t);
+	__m128d s = _mm_add_pd(_mm_mul_pd(t, _mm_sub_pd(_mm_mul_pd(t, _mm_set1_pd(6)), _mm_set1_pd(15))), _mm_set1_pd(10));
+	return _mm_mul_pd(t3, s);
+}
+
+NOISE_TARGET("sse2") static inline __m128d lerpSSE2(__m128d a, __m128d b, __m128d x) {
+	return _mm_add_pd(a, _mm_mul_pd(x, _mm_sub_pd(b, a)));
+}
+
+// spread a mask held in the low two ints over both double lanes
+NOISE_TARGET("sse2") static inline __m128d laneMaskSSE2(__m128i m) {
+	return _mm_castsi128_pd(_mm_unpacklo_epi32(m, m));
+}
+
+NOISE_TARGET("sse2") static inline __m128d selectSSE2(__m128d mask, __m128d a, __m128d b) {
+	return _mm_or_pd(_mm_and_pd(mask, b), _mm_andnot_pd(mask, a));
+}
+
+// Noise::grad without the switch: u is x for h < 8 and y otherwise, v is y
+// for h < 4, x for 12 and 14 and z otherwise, and bits 0 and 1 flip the signs
+NOISE_TARGET("sse2") static inline __m128d gradSSE2(__m128i hash, __m128d x, __m128d y, __m128d z) {
+	__m128i h = _mm_and_si128(hash, _mm_set1_epi32(15));
+	__m128i zero = _mm_setzero_si128();
+	__m128d below8 = laneMaskSSE2(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(8)), zero));
+	__m128d below4 = laneMaskSSE2(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(12)), zero));
+	__m128d useX = laneMaskSSE2(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(13)), _mm_set1_epi32(12)));
+	__m128d negU = laneMaskSSE2(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+	__m128d negV = laneMaskSSE2(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+
+	__m128d sign = _mm_set1_pd(-0.0);
+	__m128d u = selectSSE2(below8, y, x);
+	__m128d v = selectSSE2(below4, selectSSE2(useX, z, x), y);
+	u = _mm_xor_pd(u, _mm_and_pd(negU, sign));
+	v = _mm_xor_pd(v, _mm_and_pd(negV, sign));
+	return _mm_add_pd(u, v);
+}
+
+// SSE2 has no gather, so the hashes are looked up a lane at a time
+NOISE_TARGET("sse2") static size_t noiseSSE2(const int *p, const double *x, const double *y, const double *z, double *out, size_t count) {
+	size_t n = 0;
+	for (; n + 2 <= count; n += 2) {
+		__m128i cx, cy, cz;
+		__m128d xf = splitSSE2(_mm_loadu_pd(x + n), cx);
+		__m128d yf = splitSSE2(_mm_loadu_pd(y + n), cy);
+		__m128d zf = splitSSE2(_mm_loadu_pd(z + n), cz);
+		__m128d u = fadeSSE2(xf);
+		__m128d v = fadeSSE2(yf);
+		__m128d w = fadeSSE2(zf);
+
+		int xi[4], yi[4], zi[4];
+		_mm_storeu_si128((__m128i *)xi, cx);
+		_mm_storeu_si128((__m128i *)yi, cy);
+		_mm_storeu_si128((__m128i *)zi, cz);
+
+		// corner hashes in the order aaa, baa, aba, bba, aab, bab, abb, bbb
+		int hash[8][4] = {};
+		for (int l = 0; l < 2; ++l) {
+			int a = p[xi[l]], b = p[xi[l] + 1];
+			int aa = p[a + yi[l]], ab = p[a + yi[l] + 1];
+			int ba = p[b + yi[l]], bb = p[b + yi[l] + 1];
+			hash[0][l] = p[aa + zi[l]];
+			hash[1][l] = p[ba + zi[l]];
+			hash[2][l] = p[ab + zi[l]];
+			hash[3][l] = p[bb + zi[l]];
+			hash[4][l] = p[aa + zi[l] + 1];
+			hash[5][l] = p[ba + zi[l] + 1];
+			hash[6][l] = p[ab + zi[l] + 1];
+			hash[7][l] = p[bb + zi[l] + 1];
+		}
+
+		__m128d one = _mm_set1_pd(1);
+		__m128d xf1 = _mm_sub_pd(xf, one);
+		__m128d yf1 = _mm_sub_pd(yf, one);
+		__m128d zf1 = _mm_sub_pd(zf, one);
+		__m128d x1, x2, y1, y2;
+		x1 = lerpSSE2(gradSSE2(_mm_loadu_si128((__m128i *)hash[0]), xf, yf, zf),
+			gradSSE2(_mm_loadu_si128((__m128i *)hash[1]), xf1, yf, zf), u);
+		x2 = lerpSSE2(gradSSE2(_mm_loadu_si128((__m128i *)hash[2]), xf, yf1, zf),
+			gradSSE2(_mm_loadu_si128((__m128i *)hash[3]), xf1, yf1, zf), u);
+		y1 = lerpSSE2(x1, x2, v);
+		x1 = lerpSSE2(gradSSE2(_mm_loadu_si128((__m128i *)hash[4]), xf, yf, zf1),
+			gradSSE2(_mm_loadu_si128((__m128i *)hash[5]), xf1, yf, zf1), u);
+		x2 = lerpSSE2(gradSSE2(_mm_loadu_si128((__m128i *)hash[6]), xf, yf1, zf1),
+			gradSSE2(_mm_loadu_si128((__m128i *)hash[7]), xf1, yf1, zf1), u);
+		y2 = lerpSSE2(x1, x2, v);
+
+		__m128d result = _mm_div_pd(_mm_add_pd(lerpSSE2(y1, y2, w), one), _mm_set1_pd(2));
+		_mm_storeu_pd(out + n, result);
+	}
+	return n;
+}
+
+NOISE_TARGET("avx2") static inline __m256d splitAVX2(__m256d v, __m128i &cell) {
+	__m128i t = _mm256_cvttpd_epi32(v);
+	cell = _mm_and_si128(t, _mm_set1_epi32(255));
+	return _mm256_sub_pd(v, _mm256_cvtepi32_pd(t));
+}
+
+NOISE_TARGET("avx2") static inline __m256d fadeAVX2(__m256d t) {
+	__m256d t3 = _mm256_mul_pd(_mm256_mul_pd(t, t), t);
+	__m256d s = _mm256_add_pd(_mm256_mul_pd(t, _mm256_sub_pd(_mm256_mul_pd(t, _mm256_set1_pd(6)), _mm256_set1_pd(15))), _mm256_set1_pd(10));
+	return _mm256_mul_pd(t3, s);
+}
+
+NOISE_TARGET("avx2") static inline __m256d lerpAVX2(__m256d a, __m256d b, __m256d x) {
+	return _mm256_add_pd(a, _mm256_mul_pd(x, _mm256_sub_pd(b, a)));
+}
+
+NOISE_TARGET("avx2") static inline __m256d laneMaskAVX2(__m128i m) {
+	return _mm256_castsi256_pd(_mm256_cvtepi32_epi64(m));
+}
+
+NOISE_TARGET("avx2") static inline __m256d gradAVX2(__m128i hash, __m256d x, __m256d y, __m256d z) {
+	__m128i h = _mm_and_si128(hash, _mm_set1_epi32(15));
+	__m128i zero = _mm_setzero_si128();
+	__m256d below8 = laneMaskAVX2(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(8)), zero));
+	__m256d below4 = laneMaskAVX2(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(12)), zero));
+	__m256d useX = laneMaskAVX2(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(13)), _mm_set1_epi32(12)));
+	__m256d negU = laneMaskAVX2(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+	__m256d negV = laneMaskAVX2(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+
+	__m256d sign = _mm256_set1_pd(-0.0);
+	__m256d u = _mm256_blendv_pd(y, x, below8);
+	__m256d v = _mm256_blendv_pd(_mm256_blendv_pd(z, x, useX), y, below4);
+	u = _mm256_xor_pd(u, _mm256_and_pd(negU, sign));
+	v = _mm256_xor_pd(v, _mm256_and_pd(negV, sign));
+	return _mm256_add_pd(u, v);
+}
+
+NOISE_TARGET("avx2") static inline __m128i gatherAVX2(const int *p, __m128i index) {
+	return _mm_i32gather_epi32(p, index, 4);
+}
+
+NOISE_TARGET("avx2") static size_t noiseAVX2(const int *p, const double *x, const double *y, const double *z, double *out, size_t count) {
+	__m128i one32 = _mm_set1_epi32(1);
+	__m256d one = _mm256_set1_pd(1);
+	size_t n = 0;
+	for (; n + 4 <= count; n += 4) {
+		__m128i xi, yi, zi;
+		__m256d xf = splitAVX2(_mm256_loadu_pd(x + n), xi);
+		__m256d yf = splitAVX2(_mm256_loadu_pd(y + n), yi);
+		__m256d zf = splitAVX2(_mm256_loadu_pd(z + n), zi);
+		__m256d u = fadeAVX2(xf);
+		__m256d v = fadeAVX2(yf);
+		__m256d w = fadeAVX2(zf);
+
+		__m128i yi1 = _mm_add_epi32(yi, one32);
+		__m128i zi1 = _mm_add_epi32(zi, one32);
+		__m128i a = gatherAVX2(p, xi);
+		__m128i b = gatherAVX2(p, _mm_add_epi32(xi, one32));
+		__m128i aa = gatherAVX2(p, _mm_add_epi32(a, yi));
+		__m128i ab = gatherAVX2(p, _mm_add_epi32(a, yi1));
+		__m128i ba = gatherAVX2(p, _mm_add_epi32(b, yi));
+		__m128i bb = gatherAVX2(p, _mm_add_epi32(b, yi1));
+
+		__m256d xf1 = _mm256_sub_pd(xf, one);
+		__m256d yf1 = _mm256_sub_pd(yf, one);
+		__m256d zf1 = _mm256_sub_pd(zf, one);
+		__m256d x1, x2, y1, y2;
+		x1 = lerpAVX2(gradAVX2(gatherAVX2(p, _mm_add_epi32(aa, zi)), xf, yf, zf),
+			gradAVX2(gatherAVX2(p, _mm_add_epi32(ba, zi)), xf1, yf, zf), u);
+		x2 = lerpAVX2(gradAVX2(gatherAVX2(p, _mm_add_epi32(ab, zi)), xf, yf1, zf),
+			gradAVX2(gatherAVX2(p, _mm_add_epi32(bb, zi)), xf1, yf1, zf), u);
+		y1 = lerpAVX2(x1, x2, v);
+		x1 = lerpAVX2(gradAVX2(gatherAVX2(p, _mm_add_epi32(aa, zi1)), xf, yf, zf1),
+			gradAVX2(gatherAVX2(p, _mm_add_epi32(ba, zi1)), xf1, yf, zf1), u);
+		x2 = lerpAVX2(gradAVX2(gatherAVX2(p, _mm_add_epi32(ab, zi1)), xf, yf1, zf1),
+			gradAVX2(gatherAVX2(p, _mm_add_epi32(bb, zi1)), xf1, yf1, zf1), u);
+		y2 = lerpAVX2(x1, x2, v);
+
+		__m256d result = _mm256_div_pd(_mm256_add_pd(lerpAVX2(y1, y2, w), one), _mm256_set1_pd(2));
+		_mm256_storeu_pd(out + n, result);
+	}
+	return n;
+}
+
+// AVX-512F keeps the eight lane indices in a ymm register and gathers with AVX2
+NOISE_TARGET("avx512f") static inline __m512d splitAVX512(__m512d v, __m256i &cell) {
+	__m256i t = _mm512_cvttpd_epi32(v);
+	cell = _mm256_and_si256(t, _mm256_set1_epi32(255));
+	return _mm512_sub_pd(v, _mm512_cvtepi32_pd(t));
+}
+
+NOISE_TARGET("avx512f") static inline __m512d fadeAVX512(__m512d t) {
+	__m512d t3 = _mm512_mul_pd(_mm512_mul_pd(t, t), t);
+	__m512d s = _mm512_add_pd(_mm512_mul_pd(t, _mm512_sub_pd(_mm512_mul_pd(t, _mm512_set1_pd(6)), _mm512_set1_pd(15))), _mm512_set1_pd(10));
+	return _mm512_mul_pd(t3, s);
+}
+
+NOISE_TARGET("avx512f") static inline __m512d lerpAVX512(__m512d a, __m512d b, __m512d x) {
+	return _mm512_add_pd(a, _mm512_mul_pd(x, _mm512_sub_pd(b, a)));
+}
+
+NOISE_TARGET("avx512f") static inline __m512d gradAVX512(__m256i hash, __m512d x, __m512d y, __m512d z) {
+	__m512i h = _mm512_cvtepi32_epi64(_mm256_and_si256(hash, _mm256_set1_epi32(15)));
+	__mmask8 atLeast8 = _mm512_test_epi64_mask(h, _mm512_set1_epi64(8));
+	__mmask8 atLeast4 = _mm512_test_epi64_mask(h, _mm512_set1_epi64(12));
+	__mmask8 useX = _mm512_cmpeq_epi64_mask(_mm512_and_si512(h, _mm512_set1_epi64(13)), _mm512_set1_epi64(12));
+	__mmask8 negU = _mm512_test_epi64_mask(h, _mm512_set1_epi64(1));
+	__mmask8 negV = _mm512_test_epi64_mask(h, _mm512_set1_epi64(2));
+
+	__m512i sign = _mm512_set1_epi64(0x8000000000000000LL);
+	__m512i u = _mm512_castpd_si512(_mm512_mask_blend_pd(atLeast8, x, y));
+	__m512i v = _mm512_castpd_si512(_mm512_mask_blend_pd(atLeast4, y, _mm512_mask_blend_pd(useX, z, x)));
+	u = _mm512_mask_xor_epi64(u, negU, u, sign);
+	v = _mm512_mask_xor_epi64(v, negV, v, sign);
+	return _mm512_add_pd(_mm512_castsi512_pd(u), _mm512_castsi512_pd(v));
+}
+
+NOISE_TARGET("avx512f") static inline __m256i gatherAVX512(const int *p, __m256i index) {
+	return _mm256_i32gather_epi32(p, index, 4);
+}
+
+NOISE_TARGET("avx512f") static size_t noiseAVX512(const int *p, const double *x, const double *y, const double *z, double *out, size_t count) {
+	__m256i one32 = _mm256_set1_epi32(1);
+	__m512d one = _mm512_set1_pd(1);
+	size_t n = 0;
+	for (; n + 8 <= count; n += 8) {
+		__m256i xi, yi, zi;
+		__m512d xf = splitAVX512(_mm512_loadu_pd(x + n), xi);
+		__m512d yf = splitAVX512(_mm512_loadu_pd(y + n), yi);
+		__m512d zf = splitAVX512(_mm512_loadu_pd(z + n), zi);
+		__m512d u = fadeAVX512(xf);
+		__m512d v = fadeAVX512(yf);
+		__m512d w = fadeAVX512(zf);
+
+		__m256i yi1 = _mm256_add_epi32(yi, one32);
+		__m256i zi1 = _mm256_add_epi32(zi, one32);
+		__m256i a = gatherAVX512(p, xi);
+		__m256i b = gatherAVX512(p, _mm256_add_epi32(xi, one32));
+		__m256i aa = gatherAVX512(p, _mm256_add_epi32(a, yi));
+		__m256i ab = gatherAVX512(p, _mm256_add_epi32(a, yi1));
+		__m256i ba = gatherAVX512(p, _mm256_add_epi32(b, yi));
+		__m256i bb = gatherAVX512(p, _mm256_add_epi32(b, yi1));
+
+		__m512d xf1 = _mm512_sub_pd(xf, one);
+		__m512d yf1 = _mm512_sub_pd(yf, one);
+		__m512d zf1 = _mm512_sub_pd(zf, one);
+		__m512d x1, x2, y1, y2;
+		x1 = lerpAVX512(gradAVX512(gatherAVX512(p, _mm256_add_epi32(aa, zi)), xf, yf, zf),
+			gradAVX512(gatherAVX512(p, _mm256_add_epi32(ba, zi)), xf1, yf, zf), u);
+		x2 = lerpAVX512(gradAVX512(gatherAVX512(p, _mm256_add_epi32(ab, zi)), xf, yf1, zf),
+			gradAVX512(gatherAVX512(p, _mm256_add_epi32(bb, zi)), xf1, yf1, zf), u);
+		y1 = lerpAVX512(x1, x2, v);
+		x1 = lerpAVX512(gradAVX512(gatherAVX512(p, _mm256_add_epi32(aa, zi1)), xf, yf, zf1),
+			gradAVX512(gatherAVX512(p, _mm256_add_epi32(ba, zi1)), xf1, yf, zf1), u);
+		x2 = lerpAVX512(gradAVX512(gatherAVX512(p, _mm256_add_epi32(ab, zi1)), xf, yf1, zf1),
+			gradAVX512(gatherAVX512(p, _mm256_add_epi32(bb, zi1)), xf1, yf1, zf1), u);
+		y2 = lerpAVX512(x1, x2, v);
+
+		__m512d result = _mm512_div_pd(_mm512_add_pd(lerpAVX512(y1, y2, w), one), _mm512_set1_pd(2));
+		_mm512_storeu_pd(out + n, result);
+	}
+	return n;
+}
+
+// Float kernels for NoiseF: the same steps in 4, 8 and 16 lanes. With one
+// int per lane the masks need no widening.
+NOISE_TARGET("sse2") static inline __m128 splitSSE2(__m128 v, __m128i &cell) {
+	__m128i t = _mm_cvttps_epi32(v);
+	cell = _mm_and_si128(t, _mm_set1_epi32(255));
+	return _mm_sub_ps(v, _mm_cvtepi32_ps(t));
+}
+
+NOISE_TARGET("sse2") static inline __m128 fadeSSE2(__m128 t) {
+	__m128 t3 = _mm_mul_ps(_mm_mul_ps(t, t), t);
+	__m128 s = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6)), _mm_set1_ps(15))), _mm_set1_ps(10));
+	return _mm_mul_ps(t3, s);
+}
+
+NOISE_TARGET("sse2") static inline __m128 lerpSSE2(__m128 a, __m128 b, __m128 x) {
+	return _mm_add_ps(a, _mm_mul_ps(x, _mm_sub_ps(b, a)));
+}
+
+NOISE_TARGET("sse2") static inline __m128 selectSSE2(__m128 mask, __m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+}
+
+NOISE_TARGET("sse2") static inline __m128 gradSSE2(__m128i hash, __m128 x, __m128 y, __m128 z) {
+	__m128i h = _mm_and_si128(hash, _mm_set1_epi32(15));
+	__m128i zero = _mm_setzero_si128();
+	__m128 below8 = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(8)), zero));
+	__m128 below4 = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(12)), zero));
+	__m128 useX = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(13)), _mm_set1_epi32(12)));
+	__m128 negU = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+	__m128 negV = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+
+	__m128 sign = _mm_set1_ps(-0.0f);
+	__m128 u = selectSSE2(below8, y, x);
+	__m128 v = selectSSE2(below4, selectSSE2(useX, z, x), y);
+	u = _mm_xor_ps(u, _mm_and_ps(negU, sign));
+	v = _mm_xor_ps(v, _mm_and_ps(negV, sign));
+	return _mm_add_ps(u, v);
+}
+
+NOISE_TARGET("sse2") static size_t noiseSSE2(const int *p, const float *x, const float *y, const float *z, float *out, size_t count) {
+	size_t n = 0;
+	for (; n + 4 <= count; n += 4) {
+		__m128i cx, cy, cz;
+		__m128 xf = splitSSE2(_mm_loadu_ps(x + n), cx);
+		__m128 yf = splitSSE2(_mm_loadu_ps(y + n), cy);
+		__m128 zf = splitSSE2(_mm_loadu_ps(z + n), cz);
+		__m128 u = fadeSSE2(xf);
+		__m128 v = fadeSSE2(yf);
+		__m128 w = fadeSSE2(zf);
+
+		int xi[4], yi[4], zi[4];
+		_mm_storeu_si128((__m128i *)xi, cx);
+		_mm_storeu_si128((__m128i *)yi, cy);
+		_mm_storeu_si128((__m128i *)zi, cz);
+
+		int hash[8][4];
+		for (int l = 0; l < 4; ++l) {
+			int a = p[xi[l]], b = p[xi[l] + 1];
+			int aa = p[a + yi[l]], ab = p[a + yi[l] + 1];
+			int ba = p[b + yi[l]], bb = p[b + yi[l] + 1];
+			hash[0][l] = p[aa + zi[l]];
+			hash[1][l] = p[ba + zi[l]];
+			hash[2][l] = p[ab + zi[l]];
+			hash[3][l] = p[bb + zi[l]];
+			hash[4][l] = p[aa + zi[l] + 1];
+			hash[5][l] = p[ba + zi[l] + 1];
+			hash[6][l] = p[ab + zi[l] + 1];
+			hash[7][l] = p[bb + zi[l] + 1];
+		}
+
+		__m128 one = _mm_set1_ps(1);
+		__m128 xf1 = _mm_sub_ps(xf, one);
+		__m128 yf1 = _mm_sub_ps(yf, one);
+		__m128 zf1 = _mm_sub_ps(zf, one);
+		__m128 x1, x2, y1, y2;
+		x1 = lerpSSE2(gradSSE2(_mm_loadu_si128((__m128i *)hash[0]), xf, yf, zf),
+			gradSSE2(_mm_loadu_si128((__m128i *)hash[1]), xf1, yf, zf), u);
+		x2 = lerpSSE2(gradSSE2(_mm_loadu_si128((__m128i *)hash[2]), xf, yf1, zf),
+			gradSSE2(_mm_loadu_si128((__m128i *)hash[3]), xf1, yf1, zf), u);
+		y1 = lerpSSE2(x1, x2, v);
+		x1 = lerpSSE2(gradSSE2(_mm_loadu_si128((__m128i *)hash[4]), xf, yf, zf1),
+			gradSSE2(_mm_loadu_si128((__m128i *)hash[5]), xf1, yf, zf1), u);
+		x2 = lerpSSE2(gradSSE2(_mm_loadu_si128((__m128i *)hash[6]), xf, yf1, zf1),
+			gradSSE2(_mm_loadu_si128((__m128i *)hash[7]), xf1, yf1, zf1), u);
+		y2 = lerpSSE2(x1, x2, v);
+
+		__m128 result = _mm_div_ps(_mm_add_ps(lerpSSE2(y1, y2, w), one), _mm_set1_ps(2));
+		_mm_storeu_ps(out + n, result);
+	}
+	return n;
+}
+
+NOISE_TARGET("avx2") static inline __m256 splitAVX2(__m256 v, __m256i &cell) {
+	__m256i t = _mm256_cvttps_epi32(v);
+	cell = _mm256_and_si256(t, _mm256_set1_epi32(255));
+	return _mm256_sub_ps(v, _mm256_cvtepi32_ps(t));
+}
+
+NOISE_TARGET("avx2") static inline __m256 fadeAVX2(__m256 t) {
+	__m256 t3 = _mm256_mul_ps(_mm256_mul_ps(t, t), t);
+	__m256 s = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6)), _mm256_set1_ps(15))), _mm256_set1_ps(10));
+	return _mm256_mul_ps(t3, s);
+}
+
+NOISE_TARGET("avx2") static inline __m256 lerpAVX2(__m256 a, __m256 b, __m256 x) {
+	return _mm256_add_ps(a, _mm256_mul_ps(x, _mm256_sub_ps(b, a)));
+}
+
+NOISE_TARGET("avx2") static inline __m256 gradAVX2(__m256i hash, __m256 x, __m256 y, __m256 z) {
+	__m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+	__m256i zero = _mm256_setzero_si256();
+	__m256 below8 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(h, _mm256_set1_epi32(8)), zero));
+	__m256 below4 = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(h, _mm256_set1_epi32(12)), zero));
+	__m256 useX = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(h, _mm256_set1_epi32(13)), _mm256_set1_epi32(12)));
+	__m256 negU = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+	__m256 negV = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), _mm256_set1_epi32(2)));
+
+	__m256 sign = _mm256_set1_ps(-0.0f);
+	__m256 u = _mm256_blendv_ps(y, x, below8);
+	__m256 v = _mm256_blendv_ps(_mm256_blendv_ps(z, x, useX), y, below4);
+	u = _mm256_xor_ps(u, _mm256_and_ps(negU, sign));
+	v = _mm256_xor_ps(v, _mm256_and_ps(negV, sign));
+	return _mm256_add_ps(u, v);
+}
+
+NOISE_TARGET("avx2") static inline __m256i gatherAVX2(const int *p, __m256i index) {
+	return _mm256_i32gather_epi32(p, index, 4);
+}
+
+NOISE_TARGET("avx2") static size_t noiseAVX2(const int *p, const float *x, const float *y, const float *z, float *out, size_t count) {
+	__m256i one32 = _mm256_set1_epi32(1);
+	__m256 one = _mm256_set1_ps(1);
+	size_t n = 0;
+	for (; n + 8 <= count; n += 8) {
+		__m256i xi, yi, zi;
+		__m256 xf = splitAVX2(_mm256_loadu_ps(x + n), xi);
+		__m256 yf = splitAVX2(_mm256_loadu_ps(y + n), yi);
+		__m256 zf = splitAVX2(_mm256_loadu_ps(z + n), zi);
+		__m256 u = fadeAVX2(xf);
+		__m256 v = fadeAVX2(yf);
+		__m256 w = fadeAVX2(zf);
+
+		__m256i yi1 = _mm256_add_epi32(yi, one32);
+		__m256i zi1 = _mm256_add_epi32(zi, one32);
+		__m256i a = gatherAVX2(p, xi);
+		__m256i b = gatherAVX2(p, _mm256_add_epi32(xi, one32));
+		__m256i aa = gatherAVX2(p, _mm256_add_epi32(a, yi));
+		__m256i ab = gatherAVX2(p, _mm256_add_epi32(a, yi1));
+		__m256i ba = gatherAVX2(p, _mm256_add_epi32(b, yi));
+		__m256i bb = gatherAVX2(p, _mm256_add_epi32(b, yi1));
+
+		__m256 xf1 = _mm256_sub_ps(xf, one);
+		__m256 yf1 = _mm256_sub_ps(yf, one);
+		__m256 zf1 = _mm256_sub_ps(zf, one);
+		__m256 x1, x2, y1, y2;
+		x1 = lerpAVX2(gradAVX2(gatherAVX2(p, _mm256_add_epi32(aa, zi)), xf, yf, zf),
+			gradAVX2(gatherAVX2(p, _mm256_add_epi32(ba, zi)), xf1, yf, zf), u);
+		x2 = lerpAVX2(gradAVX2(gatherAVX2(p, _mm256_add_epi32(ab, zi)), xf, yf1, zf),
+			gradAVX2(gatherAVX2(p, _mm256_add_epi32(bb, zi)), xf1, yf1, zf), u);
+		y1 = lerpAVX2(x1, x2, v);
+		x1 = lerpAVX2(gradAVX2(gatherAVX2(p, _mm256_add_epi32(aa, zi1)), xf, yf, zf1),
+			gradAVX2(gatherAVX2(p, _mm256_add_epi32(ba, zi1)), xf1, yf, zf1), u);
+		x2 = lerpAVX2(gradAVX2(gatherAVX2(p, _mm256_add_epi32(ab, zi1)), xf, yf1, zf1),
+			gradAVX2(gatherAVX2(p, _mm256_add_epi32(bb, zi1)), xf1, yf1, zf1), u);
+		y2 = lerpAVX2(x1, x2, v);
+
+		__m256 result = _mm256_div_ps(_mm256_add_ps(lerpAVX2(y1, y2, w), one), _mm256_set1_ps(2));
+		_mm256_storeu_ps(out + n, result);
+	}
+	return n;
+}
+
+NOISE_TARGET("avx512f") static inline __m512 splitAVX512(__m512 v, __m512i &cell) {
+	__m512i t = _mm512_cvttps_epi32(v);
+	cell = _mm512_and_si512(t, _mm512_set1_epi32(255));
+	return _mm512_sub_ps(v, _mm512_cvtepi32_ps(t));
+}
+
+NOISE_TARGET("avx512f") static inline __m512 fadeAVX512(__m512 t) {
+	__m512 t3 = _mm512_mul_ps(_mm512_mul_ps(t, t), t);
+	__m512 s = _mm512_add_ps(_mm512_mul_ps(t, _mm512_sub_ps(_mm512_mul_ps(t, _mm512_set1_ps(6)), _mm512_set1_ps(15))), _mm512_set1_ps(10));
+	return _mm512_mul_ps(t3, s);
+}
+
+NOISE_TARGET("avx512f") static inline __m512 lerpAVX512(__m512 a, __m512 b, __m512 x) {
+	return _mm512_add_ps(a, _mm512_mul_ps(x, _mm512_sub_ps(b, a)));
+}
+
+NOISE_TARGET("avx512f") static inline __m512 gradAVX512(__m512i hash, __m512 x, __m512 y, __m512 z) {
+	__m512i h = _mm512_and_si512(hash, _mm512_set1_epi32(15));
+	__mmask16 atLeast8 = _mm512_test_epi32_mask(h, _mm512_set1_epi32(8));
+	__mmask16 atLeast4 = _mm512_test_epi32_mask(h, _mm512_set1_epi32(12));
+	__mmask16 useX = _mm512_cmpeq_epi32_mask(_mm512_and_si512(h, _mm512_set1_epi32(13)), _mm512_set1_epi32(12));
+	__mmask16 negU = _mm512_test_epi32_mask(h, _mm512_set1_epi32(1));
+	__mmask16 negV = _mm512_test_epi32_mask(h, _mm512_set1_epi32(2));
+
+	__m512i sign = _mm512_set1_epi32(0x80000000);
+	__m512i u = _mm512_castps_si512(_mm512_mask_blend_ps(atLeast8, x, y));
+	__m512i v = _mm512_castps_si512(_mm512_mask_blend_ps(atLeast4, y, _mm512_mask_blend_ps(useX, z, x)));
+	u = _mm512_mask_xor_epi32(u, negU, u, sign);
+	v = _mm512_mask_xor_epi32(v, negV, v, sign);
+	return _mm512_add_ps(_mm512_castsi512_ps(u), _mm512_castsi512_ps(v));
+}
+
+NOISE_TARGET("avx512f") static inline __m512i gatherAVX512(const int *p, __m512i index) {
+	return _mm512_i32gather_epi32(index, p, 4);
+}
+
+NOISE_TARGET("avx512f") static size_t noiseAVX512(const int *p, const float *x, const float *y, const float *z, float *out, size_t count) {
+	__m512i one32 = _mm512_set1_epi32(1);
+	__m512 one = _mm512_set1_ps(1);
+	size_t n = 0;
+	for (; n + 16 <= count; n += 16) {
+		__m512i xi, yi, zi;
+		__m512 xf = splitAVX512(_mm512_loadu_ps(x + n), xi);
+		__m512 yf = splitAVX512(_mm512_loadu_ps(y + n), yi);
+		__m512 zf = splitAVX512(_mm512_loadu_ps(z + n), zi);
+		__m512 u = fadeAVX512(xf);
+		__m512 v = fadeAVX512(yf);
+		__m512 w = fadeAVX512(zf);
+
+		__m512i yi1 = _mm512_add_epi32(yi, one32);
+		__m512i zi1 = _mm512_add_epi32(zi, one32);
+		__m512i a = gatherAVX512(p, xi);
+		__m512i b = gatherAVX512(p, _mm512_add_epi32(xi, one32));
+		__m512i aa = gatherAVX512(p, _mm512_add_epi32(a, yi));
+		__m512i ab = gatherAVX512(p, _mm512_add_epi32(a, yi1));
+		__m512i ba = gatherAVX512(p, _mm512_add_epi32(b, yi));
+		__m512i bb = gatherAVX512(p, _mm512_add_epi32(b, yi1));
+
+		__m512 xf1 = _mm512_sub_ps(xf, one);
+		__m512 yf1 = _mm512_sub_ps(yf, one);
+		__m512 zf1 = _mm512_sub_ps(zf, one);
+		__m512 x1, x2, y1, y2;
+		x1 = lerpAVX512(gradAVX512(gatherAVX512(p, _mm512_add_epi32(aa, zi)), xf, yf, zf),
+			gradAVX512(gatherAVX512(p, _mm512_add_epi32(ba, zi)), xf1, yf, zf), u);
+		x2 = lerpAVX512(gradAVX512(gatherAVX512(p, _mm512_add_epi32(ab, zi)), xf, yf1, zf),
+			gradAVX512(gatherAVX512(p, _mm512_add_epi32(bb, zi)), xf1, yf1, zf), u);
+		y1 = lerpAVX512(x1, x2, v);
+		x1 = lerpAVX512(gradAVX512(gatherAVX512(p, _mm512_add_epi32(aa, zi1)), xf, yf, zf1),
+			gradAVX512(gatherAVX512(p, _mm512_add_epi32(ba, zi1)), xf1, yf, zf1), u);
+		x2 = lerpAVX512(gradAVX512(gatherAVX512(p, _mm512_add_epi32(ab, zi1)), xf, yf1, zf1),
+			gradAVX512(gatherAVX512(p, _mm512_add_epi32(bb, zi1)), xf1, yf1, zf1), u);
+		y2 = lerpAVX512(x1, x2, v);
+
+		__m512 result = _mm512_div_ps(_mm512_add_ps(lerpAVX512(y1, y2, w), one), _mm512_set1_ps(2));
+		_mm512_storeu_ps(out + n, result);
+	}
+	return n;
+}
+
+// Simplex::noise in vector lanes. The tetrahedron is picked with compares
+// instead of branches, and a corner past its radius adds t = 0 as in the scalar code.
+static const double SIMPLEX_F3 = 1.0 / 3.0;
+static const double SIMPLEX_G3 = 1.0 / 6.0;
+static const double SIMPLEX_F4 = 0.30901699437494745;
+static const double SIMPLEX_G4 = 0.1381966011250105;
+
+NOISE_TARGET("avx2") static inline __m256d cornerAVX2(__m128i hash, __m256d x, __m256d y, __m256d z) {
+	__m256d t = _mm256_sub_pd(_mm256_sub_pd(_mm256_sub_pd(_mm256_set1_pd(0.5), _mm256_mul_pd(x, x)), _mm256_mul_pd(y, y)), _mm256_mul_pd(z, z));
+	t = _mm256_max_pd(t, _mm256_setzero_pd());
+	t = _mm256_mul_pd(t, t);
+	return _mm256_mul_pd(_mm256_mul_pd(t, t), gradAVX2(hash, x, y, z));
+}
+
+// a compare mask as 0 or 1, in double and int lanes
+NOISE_TARGET("avx2") static inline __m256d stepAVX2(__m256d mask, __m128i &step) {
+	__m256d d = _mm256_and_pd(mask, _mm256_set1_pd(1));
+	step = _mm256_cvttpd_epi32(d);
+	return d;
+}
+
+NOISE_TARGET("avx2") static size_t simplexAVX2(const int *p, const double *x, const double *y, const double *z, double *out, size_t count) {
+	__m128i one32 = _mm_set1_epi32(1);
+	__m128i mask255 = _mm_set1_epi32(255);
+	__m256d one = _mm256_set1_pd(1);
+	__m256d g1 = _mm256_set1_pd(SIMPLEX_G3);
+	__m256d g2 = _mm256_set1_pd(2 * SIMPLEX_G3);
+	__m256d g3 = _mm256_set1_pd(3 * SIMPLEX_G3);
+	size_t n = 0;
+	for (; n + 4 <= count; n += 4) {
+		__m256d px = _mm256_loadu_pd(x + n);
+		__m256d py = _mm256_loadu_pd(y + n);
+		__m256d pz = _mm256_loadu_pd(z + n);
+		__m256d s = _mm256_mul_pd(_mm256_add_pd(_mm256_add_pd(px, py), pz), _mm256_set1_pd(SIMPLEX_F3));
+		__m256d i = _mm256_floor_pd(_mm256_add_pd(px, s));
+		__m256d j = _mm256_floor_pd(_mm256_add_pd(py, s));
+		__m256d k = _mm256_floor_pd(_mm256_add_pd(pz, s));
+		__m256d t = _mm256_mul_pd(_mm256_add_pd(_mm256_add_pd(i, j), k), g1);
+		__m256d x0 = _mm256_sub_pd(px, _mm256_sub_pd(i, t));
+		__m256d y0 = _mm256_sub_pd(py, _mm256_sub_pd(j, t));
+		__m256d z0 = _mm256_sub_pd(pz, _mm256_sub_pd(k, t));
+
+		__m256d xy = _mm256_cmp_pd(x0, y0, _CMP_GE_OQ);
+		__m256d xz = _mm256_cmp_pd(x0, z0, _CMP_GE_OQ);
+		__m256d yz = _mm256_cmp_pd(y0, z0, _CMP_GE_OQ);
+		__m128i i1, j1, k1, i2, j2, k2;
+		__m256d di1 = stepAVX2(_mm256_and_pd(xy, xz), i1);
+		__m256d dj1 = stepAVX2(_mm256_andnot_pd(xy, yz), j1);
+		__m256d dk1 = stepAVX2(_mm256_andnot_pd(_mm256_or_pd(xz, yz), _mm256_castsi256_pd(_mm256_set1_epi64x(-1))), k1);
+		__m256d di2 = stepAVX2(_mm256_or_pd(xy, xz), i2);
+		__m256d dj2 = _mm256_sub_pd(one, stepAVX2(_mm256_andnot_pd(yz, xy), j2));
+		__m256d dk2 = _mm256_sub_pd(one, stepAVX2(_mm256_and_pd(xz, yz), k2));
+		j2 = _mm_sub_epi32(one32, j2);
+		k2 = _mm_sub_epi32(one32, k2);
+
+		__m128i ii = _mm_and_si128(_mm256_cvttpd_epi32(i), mask255);
+		__m128i jj = _mm_and_si128(_mm256_cvttpd_epi32(j), mask255);
+		__m128i kk = _mm_and_si128(_mm256_cvttpd_epi32(k), mask255);
+		// the corners only step 0 or 1 along k, so two gathers cover the first level
+		__m128i zero32 = _mm_setzero_si128();
+		__m128i pk0 = gatherAVX2(p, kk);
+		__m128i pk1 = gatherAVX2(p, _mm_add_epi32(kk, one32));
+		__m128i pk = _mm_blendv_epi8(pk0, pk1, _mm_sub_epi32(zero32, k1));
+		__m128i pkk = _mm_blendv_epi8(pk0, pk1, _mm_sub_epi32(zero32, k2));
+		__m128i h0 = gatherAVX2(p, _mm_add_epi32(ii, gatherAVX2(p, _mm_add_epi32(jj, pk0))));
+		__m128i h1 = gatherAVX2(p, _mm_add_epi32(_mm_add_epi32(ii, i1), gatherAVX2(p, _mm_add_epi32(_mm_add_epi32(jj, j1), pk))));
+		__m128i h2 = gatherAVX2(p, _mm_add_epi32(_mm_add_epi32(ii, i2), gatherAVX2(p, _mm_add_epi32(_mm_add_epi32(jj, j2), pkk))));
+		__m128i h3 = gatherAVX2(p, _mm_add_epi32(_mm_add_epi32(ii, one32), gatherAVX2(p, _mm_add_epi32(_mm_add_epi32(jj, one32), pk1))));
+
+		__m256d sum = cornerAVX2(h0, x0, y0, z0);
+		sum = _mm256_add_pd(sum, cornerAVX2(h1, _mm256_add_pd(_mm256_sub_pd(x0, di1), g1),
+			_mm256_add_pd(_mm256_sub_pd(y0, dj1), g1), _mm256_add_pd(_mm256_sub_pd(z0, dk1), g1)));
+		sum = _mm256_add_pd(sum, cornerAVX2(h2, _mm256_add_pd(_mm256_sub_pd(x0, di2), g2),
+			_mm256_add_pd(_mm256_sub_pd(y0, dj2), g2), _mm256_add_pd(_mm256_sub_pd(z0, dk2), g2)));
+		sum = _mm256_add_pd(sum, cornerAVX2(h3, _mm256_add_pd(_mm256_sub_pd(x0, one), g3),
+			_mm256_add_pd(_mm256_sub_pd(y0, one), g3), _mm256_add_pd(_mm256_sub_pd(z0, one), g3)));
+
+		__m256d result = _mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(76), sum), one), _mm256_set1_pd(2));
+		_mm256_storeu_pd(out + n, result);
+	}
+	return n;
+}
+
+NOISE_TARGET("avx512f") static inline __m512d cornerAVX512(__m256i hash, __m512d x, __m512d y, __m512d z) {
+	__m512d t = _mm512_sub_pd(_mm512_sub_pd(_mm512_sub_pd(_mm512_set1_pd(0.5), _mm512_mul_pd(x, x)), _mm512_mul_pd(y, y)), _mm512_mul_pd(z, z));
+	t = _mm512_max_pd(t, _mm512_setzero_pd());
+	t = _mm512_mul_pd(t, t);
+	return _mm512_mul_pd(_mm512_mul_pd(t, t), gradAVX512(hash, x, y, z));
+}
+
+NOISE_TARGET("avx512f") static inline __m512d stepAVX512(__mmask8 mask, __m256i &step) {
+	__m512d d = _mm512_maskz_mov_pd(mask, _mm512_set1_pd(1));
+	step = _mm512_cvttpd_epi32(d);
+	return d;
+}
+
+NOISE_TARGET("avx512f") static size_t simplexAVX512(const int *p, const double *x, const double *y, const double *z, double *out, size_t count) {
+	__m256i one32 = _mm256_set1_epi32(1);
+	__m256i mask255 = _mm256_set1_epi32(255);
+	__m512d one = _mm512_set1_pd(1);
+	__m512d g1 = _mm512_set1_pd(SIMPLEX_G3);
+	__m512d g2 = _mm512_set1_pd(2 * SIMPLEX_G3);
+	__m512d g3 = _mm512_set1_pd(3 * SIMPLEX_G3);
+	size_t n = 0;
+	for (; n + 8 <= count; n += 8) {
+		__m512d px = _mm512_loadu_pd(x + n);
+		__m512d py = _mm512_loadu_pd(y + n);
+		__m512d pz = _mm512_loadu_pd(z + n);
+		__m512d s = _mm512_mul_pd(_mm512_add_pd(_mm512_add_pd(px, py), pz), _mm512_set1_pd(SIMPLEX_F3));
+		__m512d i = _mm512_roundscale_pd(_mm512_add_pd(px, s), _MM_FROUND_TO_NEG_INF);
+		__m512d j = _mm512_roundscale_pd(_mm512_add_pd(py, s), _MM_FROUND_TO_NEG_INF);
+		__m512d k = _mm512_roundscale_pd(_mm512_add_pd(pz, s), _MM_FROUND_TO_NEG_INF);
+		__m512d t = _mm512_mul_pd(_mm512_add_pd(_mm512_add_pd(i, j), k), g1);
+		__m512d x0 = _mm512_sub_pd(px, _mm512_sub_pd(i, t));
+		__m512d y0 = _mm512_sub_pd(py, _mm512_sub_pd(j, t));
+		__m512d z0 = _mm512_sub_pd(pz, _mm512_sub_pd(k, t));
+
+		__mmask8 xy = _mm512_cmp_pd_mask(x0, y0, _CMP_GE_OQ);
+		__mmask8 xz = _mm512_cmp_pd_mask(x0, z0, _CMP_GE_OQ);
+		__mmask8 yz = _mm512_cmp_pd_mask(y0, z0, _CMP_GE_OQ);
+		__m256i i1, j1, k1, i2, j2, k2;
+		__m512d di1 = stepAVX512(xy & xz, i1);
+		__m512d dj1 = stepAVX512(~xy & yz, j1);
+		__m512d dk1 = stepAVX512(~xz & ~yz, k1);
+		__m512d di2 = stepAVX512(xy | xz, i2);
+		__m512d dj2 = stepAVX512(~xy | yz, j2);
+		__m512d dk2 = stepAVX512(~xz | ~yz, k2);
+
+		__m256i ii = _mm256_and_si256(_mm512_cvttpd_epi32(i), mask255);
+		__m256i jj = _mm256_and_si256(_mm512_cvttpd_epi32(j), mask255);
+		__m256i kk = _mm256_and_si256(_mm512_cvttpd_epi32(k), mask255);
+		__m256i zero32 = _mm256_setzero_si256();
+		__m256i pk0 = gatherAVX512(p, kk);
+		__m256i pk1 = gatherAVX512(p, _mm256_add_epi32(kk, one32));
+		__m256i pk = _mm256_blendv_epi8(pk0, pk1, _mm256_sub_epi32(zero32, k1));
+		__m256i pkk = _mm256_blendv_epi8(pk0, pk1, _mm256_sub_epi32(zero32, k2));
+		__m256i h0 = gatherAVX512(p, _mm256_add_epi32(ii, gatherAVX512(p, _mm256_add_epi32(jj, pk0))));
+		__m256i h1 = gatherAVX512(p, _mm256_add_epi32(_mm256_add_epi32(ii, i1), gatherAVX512(p, _mm256_add_epi32(_mm256_add_epi32(jj, j1), pk))));
+		__m256i h2 = gatherAVX512(p, _mm256_add_epi32(_mm256_add_epi32(ii, i2), gatherAVX512(p, _mm256_add_epi32(_mm256_add_epi32(jj, j2), pkk))));
+		__m256i h3 = gatherAVX512(p, _mm256_add_epi32(_mm256_add_epi32(ii, one32), gatherAVX512(p, _mm256_add_epi32(_mm256_add_epi32(jj, one32), pk1))));
+
+		__m512d sum = cornerAVX512(h0, x0, y0, z0);
+		sum = _mm512_add_pd(sum, cornerAVX512(h1, _mm512_add_pd(_mm512_sub_pd(x0, di1), g1),
+			_mm512_add_pd(_mm512_sub_pd(y0, dj1), g1), _mm512_add_pd(_mm512_sub_pd(z0, dk1), g1)));
+		sum = _mm512_add_pd(sum, cornerAVX512(h2, _mm512_add_pd(_mm512_sub_pd(x0, di2), g2),
+			_mm512_add_pd(_mm512_sub_pd(y0, dj2), g2), _mm512_add_pd(_mm512_sub_pd(z0, dk2), g2)));
+		sum = _mm512_add_pd(sum, cornerAVX512(h3, _mm512_add_pd(_mm512_sub_pd(x0, one), g3),
+			_mm512_add_pd(_mm512_sub_pd(y0, one), g3), _mm512_add_pd(_mm512_sub_pd(z0, one), g3)));
+
+		__m512d result = _mm512_div_pd(_mm512_add_pd(_mm512_mul_pd(_mm512_set1_pd(76), sum), one), _mm512_set1_pd(2));
+		_mm512_storeu_pd(out + n, result);
+	}
+	return n;
+}
+
+// 4D, with the gradient picked from hash & 31 as in the scalar corner4
+NOISE_TARGET("avx2") static inline __m256d corner4AVX2(__m128i hash, __m256d x, __m256d y, __m256d z, __m256d w) {
+	__m256d t = _mm256_sub_pd(_mm256_sub_pd(_mm256_sub_pd(_mm256_sub_pd(_mm256_set1_pd(0.5), _mm256_mul_pd(x, x)),
+		_mm256_mul_pd(y, y)), _mm256_mul_pd(z, z)), _mm256_mul_pd(w, w));
+	t = _mm256_max_pd(t, _mm256_setzero_pd());
+	t = _mm256_mul_pd(t, t);
+
+	__m128i h = _mm_and_si128(hash, _mm_set1_epi32(31));
+	__m128i zero = _mm_setzero_si128();
+	__m256d below24 = laneMaskAVX2(_mm_cmplt_epi32(h, _mm_set1_epi32(24)));
+	__m256d below16 = laneMaskAVX2(_mm_cmplt_epi32(h, _mm_set1_epi32(16)));
+	__m256d below8 = laneMaskAVX2(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(24)), zero));
+	__m256d negU = laneMaskAVX2(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+	__m256d negV = laneMaskAVX2(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+	__m256d negC = laneMaskAVX2(_mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(4)), _mm_set1_epi32(4)));
+
+	__m256d sign = _mm256_set1_pd(-0.0);
+	__m256d u = _mm256_xor_pd(_mm256_blendv_pd(y, x, below24), _mm256_and_pd(negU, sign));
+	__m256d v = _mm256_xor_pd(_mm256_blendv_pd(z, y, below16), _mm256_and_pd(negV, sign));
+	__m256d c = _mm256_xor_pd(_mm256_blendv_pd(w, z, below8), _mm256_and_pd(negC, sign));
+	return _mm256_mul_pd(_mm256_mul_pd(t, t), _mm256_add_pd(_mm256_add_pd(u, v), c));
+}
+
+NOISE_TARGET("avx2") static size_t simplex4AVX2(const int *p, const double *x, const double *y, const double *z, double w, double *out, size_t count) {
+	__m128i one32 = _mm_set1_epi32(1);
+	__m128i zero32 = _mm_setzero_si128();
+	__m128i mask255 = _mm_set1_epi32(255);
+	__m256d one = _mm256_set1_pd(1);
+	__m256d pw = _mm256_set1_pd(w);
+	size_t n = 0;
+	for (; n + 4 <= count; n += 4) {
+		__m256d px = _mm256_loadu_pd(x + n);
+		__m256d py = _mm256_loadu_pd(y + n);
+		__m256d pz = _mm256_loadu_pd(z + n);
+		__m256d s = _mm256_mul_pd(_mm256_add_pd(_mm256_add_pd(_mm256_add_pd(px, py), pz), pw), _mm256_set1_pd(SIMPLEX_F4));
+		__m256d i = _mm256_floor_pd(_mm256_add_pd(px, s));
+		__m256d j = _mm256_floor_pd(_mm256_add_pd(py, s));
+		__m256d k = _mm256_floor_pd(_mm256_add_pd(pz, s));
+		__m256d l = _mm256_floor_pd(_mm256_add_pd(pw, s));
+		__m256d t = _mm256_mul_pd(_mm256_add_pd(_mm256_add_pd(_mm256_add_pd(i, j), k), l), _mm256_set1_pd(SIMPLEX_G4));
+		__m256d off[4];
+		off[0] = _mm256_sub_pd(px, _mm256_sub_pd(i, t));
+		off[1] = _mm256_sub_pd(py, _mm256_sub_pd(j, t));
+		off[2] = _mm256_sub_pd(pz, _mm256_sub_pd(k, t));
+		off[3] = _mm256_sub_pd(pw, _mm256_sub_pd(l, t));
+
+		// each offset's rank is how many of the others it exceeds, ties to the later axis
+		__m256d rank[4] = { _mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd(), _mm256_setzero_pd() };
+		for (int a = 0; a < 4; ++a) {
+			for (int b = a + 1; b < 4; ++b) {
+				__m256d greater = _mm256_cmp_pd(off[a], off[b], _CMP_GT_OQ);
+				rank[a] = _mm256_add_pd(rank[a], _mm256_and_pd(greater, one));
+				rank[b] = _mm256_add_pd(rank[b], _mm256_andnot_pd(greater, one));
+			}
+		}
+
+		__m128i cell[4];
+		cell[0] = _mm_and_si128(_mm256_cvttpd_epi32(i), mask255);
+		cell[1] = _mm_and_si128(_mm256_cvttpd_epi32(j), mask255);
+		cell[2] = _mm_and_si128(_mm256_cvttpd_epi32(k), mask255);
+		cell[3] = _mm_and_si128(_mm256_cvttpd_epi32(l), mask255);
+		// the corners only step 0 or 1 along l, so two gathers cover the first level
+		__m128i pl0 = gatherAVX2(p, cell[3]);
+		__m128i pl1 = gatherAVX2(p, _mm_add_epi32(cell[3], one32));
+
+		__m256d sum = corner4AVX2(gatherAVX2(p, _mm_add_epi32(cell[0], gatherAVX2(p, _mm_add_epi32(cell[1],
+			gatherAVX2(p, _mm_add_epi32(cell[2], pl0)))))), off[0], off[1], off[2], off[3]);
+		for (int c = 1; c <= 3; ++c) {
+			__m256d g = _mm256_set1_pd(c * SIMPLEX_G4);
+			__m256d threshold = _mm256_set1_pd(4 - c);
+			__m256d d[4];
+			__m128i step[4];
+			for (int a = 0; a < 4; ++a) {
+				d[a] = stepAVX2(_mm256_cmp_pd(rank[a], threshold, _CMP_GE_OQ), step[a]);
+			}
+			__m128i hash = _mm_blendv_epi8(pl0, pl1, _mm_sub_epi32(zero32, step[3]));
+			for (int a = 2; a >= 0; --a) {
+				hash = gatherAVX2(p, _mm_add_epi32(_mm_add_epi32(cell[a], step[a]), hash));
+			}
+			sum = _mm256_add_pd(sum, corner4AVX2(hash, _mm256_add_pd(_mm256_sub_pd(off[0], d[0]), g), _mm256_add_pd(_mm256_sub_pd(off[1], d[1]), g),
+				_mm256_add_pd(_mm256_sub_pd(off[2], d[2]), g), _mm256_add_pd(_mm256_sub_pd(off[3], d[3]), g)));
+		}
+		__m128i hash = pl1;
+		for (int a = 2; a >= 0; --a) {
+			hash = gatherAVX2(p, _mm_add_epi32(_mm_add_epi32(cell[a], one32), hash));
+		}
+		__m256d g = _mm256_set1_pd(4 * SIMPLEX_G4);
+		sum = _mm256_add_pd(sum, corner4AVX2(hash, _mm256_add_pd(_mm256_sub_pd(off[0], one), g), _mm256_add_pd(_mm256_sub_pd(off[1], one), g),
+			_mm256_add_pd(_mm256_sub_pd(off[2], one), g), _mm256_add_pd(_mm256_sub_pd(off[3], one), g)));
+
+		__m256d result = _mm256_div_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_set1_pd(62), sum), one), _mm256_set1_pd(2));
+		_mm256_storeu_pd(out + n, result);
+	}
+	return n;
+}
+
+NOISE_TARGET("avx512f") static inline __m512d corner4AVX512(__m256i hash, __m512d x, __m512d y, __m512d z, __m512d w) {
+	__m512d t = _mm512_sub_pd(_mm512_sub_pd(_mm512_sub_pd(_mm512_sub_pd(_mm512_set1_pd(0.5), _mm512_mul_pd(x, x)),
+		_mm512_mul_pd(y, y)), _mm512_mul_pd(z, z)), _mm512_mul_pd(w, w));
+	t = _mm512_max_pd(t, _mm512_setzero_pd());
+	t = _mm512_mul_pd(t, t);
+
+	__m512i h = _mm512_cvtepi32_epi64(_mm256_and_si256(hash, _mm256_set1_epi32(31)));
+	__mmask8 atLeast24 = _mm512_cmpge_epi64_mask(h, _mm512_set1_epi64(24));
+	__mmask8 atLeast16 = _mm512_cmpge_epi64_mask(h, _mm512_set1_epi64(16));
+	__mmask8 atLeast8 = _mm512_test_epi64_mask(h, _mm512_set1_epi64(24));
+	__mmask8 negU = _mm512_test_epi64_mask(h, _mm512_set1_epi64(1));
+	__mmask8 negV = _mm512_test_epi64_mask(h, _mm512_set1_epi64(2));
+	__mmask8 negC = _mm512_test_epi64_mask(h, _mm512_set1_epi64(4));
+
+	__m512i sign = _mm512_set1_epi64(0x8000000000000000LL);
+	__m512i u = _mm512_castpd_si512(_mm512_mask_blend_pd(atLeast24, x, y));
+	__m512i v = _mm512_castpd_si512(_mm512_mask_blend_pd(atLeast16, y, z));
+	__m512i c = _mm512_castpd_si512(_mm512_mask_blend_pd(atLeast8, z, w));
+	u = _mm512_mask_xor_epi64(u, negU, u, sign);
+	v = _mm512_mask_xor_epi64(v, negV, v, sign);
+	c = _mm512_mask_xor_epi64(c, negC, c, sign);
+	__m512d grad = _mm512_add_pd(_mm512_add_pd(_mm512_castsi512_pd(u), _mm512_castsi512_pd(v)), _mm512_castsi512_pd(c));
+	return _mm512_mul_pd(_mm512_mul_pd(t, t), grad);
+}
+
+NOISE_TARGET("avx512f") static size_t simplex4AVX512(const int *p, const double *x, const double *y, const double *z, double w, double *out, size_t count) {
+	__m256i one32 = _mm256_set1_epi32(1);
+	__m256i zero32 = _mm256_setzero_si256();
+	__m256i mask255 = _mm256_set1_epi32(255);
+	__m512d one = _mm512_set1_pd(1);
+	__m512d pw = _mm512_set1_pd(w);
+	size_t n = 0;
+	for (; n + 8 <= count; n += 8) {
+		__m512d px = _mm512_loadu_pd(x + n);
+		__m512d py = _mm512_loadu_pd(y + n);
+		__m512d pz = _mm512_loadu_pd(z + n);
+		__m512d s = _mm512_mul_pd(_mm512_add_pd(_mm512_add_pd(_mm512_add_pd(px, py), pz), pw), _mm512_set1_pd(SIMPLEX_F4));
+		__m512d i = _mm512_roundscale_pd(_mm512_add_pd(px, s), _MM_FROUND_TO_NEG_INF);
+		__m512d j = _mm512_roundscale_pd(_mm512_add_pd(py, s), _MM_FROUND_TO_NEG_INF);
+		__m512d k = _mm512_roundscale_pd(_mm512_add_pd(pz, s), _MM_FROUND_TO_NEG_INF);
+		__m512d l = _mm512_roundscale_pd(_mm512_add_pd(pw, s), _MM_FROUND_TO_NEG_INF);
+		__m512d t = _mm512_mul_pd(_mm512_add_pd(_mm512_add_pd(_mm512_add_pd(i, j), k), l), _mm512_set1_pd(SIMPLEX_G4));
+		__m512d off[4];
+		off[0] = _mm512_sub_pd(px, _mm512_sub_pd(i, t));
+		off[1] = _mm512_sub_pd(py, _mm512_sub_pd(j, t));
+		off[2] = _mm512_sub_pd(pz, _mm512_sub_pd(k, t));
+		off[3] = _mm512_sub_pd(pw, _mm512_sub_pd(l, t));
+
+		__m512d rank[4] = { _mm512_setzero_pd(), _mm512_setzero_pd(), _mm512_setzero_pd(), _mm512_setzero_pd() };
+		for (int a = 0; a < 4; ++a) {
+			for (int b = a + 1; b < 4; ++b) {
+				__mmask8 greater = _mm512_cmp_pd_mask(off[a], off[b], _CMP_GT_OQ);
+				rank[a] = _mm512_mask_add_pd(rank[a], greater, rank[a], one);
+				rank[b] = _mm512_mask_add_pd(rank[b], (__mmask8)~greater, rank[b], one);
+			}
+		}
+
+		__m256i cell[4];
+		cell[0] = _mm256_and_si256(_mm512_cvttpd_epi32(i), mask255);
+		cell[1] = _mm256_and_si256(_mm512_cvttpd_epi32(j), mask255);
+		cell[2] = _mm256_and_si256(_mm512_cvttpd_epi32(k), mask255);
+		cell[3] = _mm256_and_si256(_mm512_cvttpd_epi32(l), mask255);
+		__m256i pl0 = gatherAVX512(p, cell[3]);
+		__m256i pl1 = gatherAVX512(p, _mm256_add_epi32(cell[3], one32));
+
+		__m512d sum = corner4AVX512(gatherAVX512(p, _mm256_add_epi32(cell[0], gatherAVX512(p, _mm256_add_epi32(cell[1],
+			gatherAVX512(p, _mm256_add_epi32(cell[2], pl0)))))), off[0], off[1], off[2], off[3]);
+		for (int c = 1; c <= 3; ++c) {
+			__m512d g = _mm512_set1_pd(c * SIMPLEX_G4);
+			__m512d threshold = _mm512_set1_pd(4 - c);
+			__m512d d[4];
+			__m256i step[4];
+			for (int a = 0; a < 4; ++a) {
+				d[a] = stepAVX512(_mm512_cmp_pd_mask(rank[a], threshold, _CMP_GE_OQ), step[a]);
+			}
+			__m256i hash = _mm256_blendv_epi8(pl0, pl1, _mm256_sub_epi32(zero32, step[3]));
+			for (int a = 2; a >= 0; --a) {
+				hash = gatherAVX512(p, _mm256_add_epi32(_mm256_add_epi32(cell[a], step[a]), hash));
+			}
+			sum = _mm512_add_pd(sum, corner4AVX512(hash, _mm512_add_pd(_mm512_sub_pd(off[0], d[0]), g), _mm512_add_pd(_mm512_sub_pd(off[1], d[1]), g),
+				_mm512_add_pd(_mm512_sub_pd(off[2], d[2]), g), _mm512_add_pd(_mm512_sub_pd(off[3], d[3]), g)));
+		}
+		__m256i hash = pl1;
+		for (int a = 2; a >= 0; --a) {
+			hash = gatherAVX512(p, _mm256_add_epi32(_mm256_add_epi32(cell[a], one32), hash));
+		}
+		__m512d g = _mm512_set1_pd(4 * SIMPLEX_G4);
+		sum = _mm512_add_pd(sum, corner4AVX512(hash, _mm512_add_pd(_mm512_sub_pd(off[0], one), g), _mm512_add_pd(_mm512_sub_pd(off[1], one), g),
+			_mm512_add_pd(_mm512_sub_pd(off[2], one), g), _mm512_add_pd(_mm512_sub_pd(off[3], one), g)));
+
+		__m512d result = _mm512_div_pd(_mm512_add_pd(_mm512_mul_pd(_mm512_set1_pd(62), sum), one), _mm512_set1_pd(2));
+		_mm512_storeu_pd(out + n, result);
+	}
+	return n;
+}
+
+#else
+
+SimdLevel detectSimdLevel() {
+	return SIMD_SCALAR;
+}
+
+#endif
+
+static SimdLevel detectedLevel() {
+	static const SimdLevel level = detectSimdLevel();
+	return level;
+}
+
+static std::atomic<int> activeLevel(-1);
+
+SimdLevel getSimdLevel() {
+	int level = activeLevel.load();
+	return level < 0 ? detectedLevel() : (SimdLevel)level;
+}
+
+void setSimdLevel(SimdLevel level) {
+	activeLevel.store(level < detectedLevel() ? level : detectedLevel());
+}
+
+const char *simdLevelName(SimdLevel level) {
+	switch (level) {
+	case SIMD_SSE2: return "SSE2";
+	case SIMD_AVX2: return "AVX2";
+	case SIMD_AVX512: return "AVX-512";
+	default: return "scalar";
+	}
+}
+
+size_t noiseSIMD(const int *p, const double *x, const double *y, const double *z, double *out, size_t count) {
+#ifdef NOISE_X86
+	switch (getSimdLevel()) {
+	case SIMD_AVX512: return noiseAVX512(p, x, y, z, out, count);
+	case SIMD_AVX2: return noiseAVX2(p, x, y, z, out, count);
+	case SIMD_SSE2: return noiseSSE2(p, x, y, z, out, count);
+	default: break;
+	}
+#endif
+	return 0;
+}
+
+size_t noiseSIMD(const int *p, const float *x, const float *y, const float *z, float *out, size_t count) {
+#ifdef NOISE_X86
+	switch (getSimdLevel()) {
+	case SIMD_AVX512: return noiseAVX512(p, x, y, z, out, count);
+	case SIMD_AVX2: return noiseAVX2(p, x, y, z, out, count);
+	case SIMD_SSE2: return noiseSSE2(p, x, y, z, out, count);
+	default: break;
+	}
+#endif
+	return 0;
+}
+
+size_t simplexSIMD(const int *p, const double *x, const double *y, const double *z, double *out, size_t count) {
+#ifdef NOISE_X86
+	switch (getSimdLevel()) {
+	case SIMD_AVX512: return simplexAVX512(p, x, y, z, out, count);
+	case SIMD_AVX2: return simplexAVX2(p, x, y, z, out, count);
+	default: break;
+	}
+#endif
+	return 0;
+}
+
+size_t simplexSIMD(const int *p, const double *x, const double *y, const double *z, double w, double *out, size_t count) {
+#ifdef NOISE_X86
+	switch (getSimdLevel()) {
+	case SIMD_AVX512: return simplex4AVX512(p, x, y, z, w, out, count);
+	case SIMD_AVX2: return simplex4AVX2(p, x, y, z, w, out, count);
+	default: break;
+	}
+#endif
+	return 0;
+}
@@ -0,0 +1,39 @@
+#include <cstddef>
+
+#ifndef NOISESIMD_H
+#define NOISESIMD_H
+
+// Vector kernels behind Noise's batch noise. Each one gives the same bits
+// as Noise::noise for every lane, so the level only changes the speed.
+enum SimdLevel {
+	SIMD_SCALAR,
+	SIMD_SSE2,
+	SIMD_AVX2,
+	SIMD_AVX512
+};
+
+// widest instruction set supported by both the CPU and the OS
+SimdLevel detectSimdLevel();
+
+// level the batch noise runs at, detectSimdLevel() unless lowered.
+// setSimdLevel never goes above what was detected
+SimdLevel getSimdLevel();
+void setSimdLevel(SimdLevel level);
+const char *simdLevelName(SimdLevel level);
+
+// Perlin noise of points 0, 1, ... into out using the 512 entry permutation
+// table p, with no repeat. Returns how many points were done: always a whole
+// number of vectors, the rest are left for the scalar path.
+size_t noiseSIMD(const int *p, const double *x, const double *y, const double *z, double *out, size_t count);
+
+// the same for NoiseF, in twice as many float lanes
+size_t noiseSIMD(const int *p, const float *x, const float *y, const float *z, float *out, size_t count);
+
+// Simplex::noise on the same table. Gathers make it pay only from AVX2 up;
+// below that it returns 0 and the scalar loop does every point
+size_t simplexSIMD(const int *p, const double *x, const double *y, const double *z, double *out, size_t count);
+
+// 4D Simplex::noise of the points at a shared w
+size_t simplexSIMD(const int *p, const double *x, const double *y, const double *z, double w, double *out, size_t count);
+
+#endif
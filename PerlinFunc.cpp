@@ -1,7 +1,9 @@
+#include <algorithm>
 #include <iostream>
+#include <vector>
 #include "PerlinFunc.h"
 
-PerlinFunc::PerlinFunc(GLfloat iso, GLfloat amin, GLfloat amax, GLfloat bmin, GLfloat bmax) {
+PerlinFunc::PerlinFunc(GLfloat iso, GLfloat amin, GLfloat amax, GLfloat bmin, GLfloat bmax, NoiseBasis basis) {
 	this->iso = iso;
 	this->amin = amin;
 	this->amax = amax;
@@ -11,20 +13,241 @@ PerlinFunc::PerlinFunc(GLfloat iso, GLfloat amin, GLfloat amax, GLfloat bmin, GL
 	this->y_off = 0.0;
 	this->z_off = 0.0;
 	this->pn = Noise();
+	this->pnf = NoiseF();
+	this->sn = Simplex();
+	this->basis = basis;
+	this->precision = NOISE_DOUBLE;
+	this->fbm = Fbm(1, 0.5);
+	this->earlyTermination = false;
 }
 
 bool PerlinFunc::isInside(GLfloat x, GLfloat y, GLfloat z) {
-	return pn.noise(map(x) + x_off, map(y) + y_off, map(z) + z_off) - iso < 0;
+	return function(x, y, z) < 0;
 }
 
 GLfloat PerlinFunc::function(GLfloat x, GLfloat y, GLfloat z) {
+	if (basis == NOISE_SIMPLEX) {
+		if (fbm.getOctaves() > 1) {
+			return fbm.evaluate(sn, map(x) + x_off, map(y) + y_off, map(z) + z_off) - iso;
+		}
+		return sn.noise(map(x) + x_off, map(y) + y_off, map(z) + z_off) - iso;
+	}
+	if (precision == NOISE_FLOAT) {
+		if (fbm.getOctaves() > 1) {
+			return fbm.evaluate(pnf, map(x) + x_off, map(y) + y_off, map(z) + z_off) - iso;
+		}
+		return pnf.noise(map(x) + x_off, map(y) + y_off, map(z) + z_off) - iso;
+	}
+	if (fbm.getOctaves() > 1) {
+		return fbm.evaluate(pn, map(x) + x_off, map(y) + y_off, map(z) + z_off) - iso;
+	}
 	return pn.noise(map(x) + x_off, map(y) + y_off, map(z) + z_off) - iso;
 }
 
+// analytic in double whatever the precision; map scales every axis alike.
+// Simplex has no analytic form here and takes the central differences
+GLfloat PerlinFunc::gradient(GLfloat x, GLfloat y, GLfloat z, GLfloat grad[3]) {
+	if (basis == NOISE_SIMPLEX) {
+		return ImplicitFunc::gradient(x, y, z, grad);
+	}
+	double g[3];
+	double value;
+	if (fbm.getOctaves() > 1) {
+		value = pn.octaveWithGradient(map(x) + x_off, map(y) + y_off, map(z) + z_off, fbm.getOctaves(), fbm.getPersistence(), g);
+	}
+	else {
+		value = pn.noiseWithGradient(map(x) + x_off, map(y) + y_off, map(z) + z_off, g);
+	}
+
+	double scale = (bmax - bmin) / (amax - amin);
+	for (int axis = 0; axis < 3; ++axis) {
+		grad[axis] = g[axis] * scale;
+	}
+	return value - iso;
+}
+
+void PerlinFunc::bounds(const GLfloat lo[3], const GLfloat hi[3], GLfloat &min, GLfloat &max) {
+	// map is increasing and rounds the same way for samples and box ends alike
+	GLfloat offset[3] = { x_off, y_off, z_off };
+	double mlo[3], mhi[3];
+	for (int axis = 0; axis < 3; ++axis) {
+		mlo[axis] = map(lo[axis]) + offset[axis];
+		mhi[axis] = map(hi[axis]) + offset[axis];
+	}
+
+	double low = Fbm::NOISE_LOW;
+	double high = Fbm::NOISE_HIGH;
+	if (basis == NOISE_PERLIN) {
+		if (mlo[0] < 0 || mlo[1] < 0 || mlo[2] < 0) {
+			ImplicitFunc::bounds(lo, hi, min, max);
+			return;
+		}
+		fbm.bounds(pn, mlo, mhi, low, high);
+
+		// NoiseF's error, and the rounding of its float octave sum
+		if (precision == NOISE_FLOAT) {
+			low -= NOISEF_MAX_ERROR + 1e-6;
+			high += NOISEF_MAX_ERROR + 1e-6;
+		}
+	}
+	min = (GLfloat)(low - iso);
+	max = (GLfloat)(high - iso);
+}
+
+NoiseBasis PerlinFunc::getBasis() const {
+	return basis;
+}
+
+void PerlinFunc::setPrecision(NoisePrecision precision) {
+	this->precision = precision;
+}
+
+NoisePrecision PerlinFunc::getPrecision() const {
+	return precision;
+}
+
+// one batch call per row of z values, through fbm when there is more than one octave
+template <class N, class T>
+static void fillRows(N &noise, const Fbm &fbm, bool stopEarly, GLfloat iso, const std::vector<GLfloat> &mx,
+	const std::vector<GLfloat> &my, const std::vector<GLfloat> &mz, GLfloat *out) {
+	size_t nz = mz.size();
+	std::vector<T> px(nz), py(nz), pz(mz.begin(), mz.end()), row(nz);
+	for (size_t i = 0; i < mx.size(); ++i) {
+		std::fill(px.begin(), px.end(), mx[i]);
+		for (size_t j = 0; j < my.size(); ++j) {
+			std::fill(py.begin(), py.end(), my[j]);
+			if (fbm.getOctaves() == 1) {
+				noise.noise(&px[0], &py[0], &pz[0], &row[0], nz);
+			}
+			else if (stopEarly) {
+				fbm.evaluateNear(noise, &px[0], &py[0], &pz[0], &row[0], nz, iso);
+			}
+			else {
+				fbm.evaluate(noise, &px[0], &py[0], &pz[0], &row[0], nz);
+			}
+			for (size_t k = 0; k < nz; ++k) {
+				*out++ = row[k] - iso;
+			}
+		}
+	}
+}
+
+// the same over scattered points, in one batch
+template <class N, class T>
+static void fillPoints(N &noise, const Fbm &fbm, bool stopEarly, GLfloat iso, const std::vector<GLfloat> &mx,
+	const std::vector<GLfloat> &my, const std::vector<GLfloat> &mz, GLfloat *out) {
+	size_t count = mx.size();
+	std::vector<T> px(mx.begin(), mx.end()), py(my.begin(), my.end()), pz(mz.begin(), mz.end()), value(count);
+	if (fbm.getOctaves() == 1) {
+		noise.noise(&px[0], &py[0], &pz[0], &value[0], count);
+	}
+	else if (stopEarly) {
+		fbm.evaluateNear(noise, &px[0], &py[0], &pz[0], &value[0], count, iso);
+	}
+	else {
+		fbm.evaluate(noise, &px[0], &py[0], &pz[0], &value[0], count);
+	}
+	for (size_t n = 0; n < count; ++n) {
+		out[n] = value[n] - iso;
+	}
+}
+
+void PerlinFunc::evaluatePoints(const GLfloat *x, const GLfloat *y, const GLfloat *z, GLfloat *out, size_t count) {
+	if (count == 0) {
+		return;
+	}
+	std::vector<GLfloat> mx(count), my(count), mz(count);
+	GLfloat lowest = 0;
+	for (size_t n = 0; n < count; ++n) {
+		mx[n] = map(x[n]) + x_off;
+		my[n] = map(y[n]) + y_off;
+		mz[n] = map(z[n]) + z_off;
+		lowest = std::min(lowest, std::min(mx[n], std::min(my[n], mz[n])));
+	}
+
+	bool stopEarly = earlyTermination && (lowest >= 0 || basis == NOISE_SIMPLEX);
+	if (basis == NOISE_SIMPLEX) {
+		fillPoints<Simplex, double>(sn, fbm, stopEarly, iso, mx, my, mz, out);
+	}
+	else if (precision == NOISE_FLOAT) {
+		fillPoints<NoiseF, float>(pnf, fbm, stopEarly, iso, mx, my, mz, out);
+	}
+	else {
+		fillPoints<Noise, double>(pn, fbm, stopEarly, iso, mx, my, mz, out);
+	}
+}
+
+void PerlinFunc::evaluateBlock(const GLfloat *xs, size_t nx, const GLfloat *ys, size_t ny,
+	const GLfloat *zs, size_t nz, GLfloat *out) {
+	fillBlock(xs, nx, ys, ny, zs, nz, earlyTermination, iso, out);
+}
+
+// early termination is left off, as where it stops depends on iso
+void PerlinFunc::evaluateRawBlock(const GLfloat *xs, size_t nx, const GLfloat *ys, size_t ny,
+	const GLfloat *zs, size_t nz, GLfloat *out) {
+	fillBlock(xs, nx, ys, ny, zs, nz, false, 0, out);
+}
+
+void PerlinFunc::fillBlock(const GLfloat *xs, size_t nx, const GLfloat *ys, size_t ny,
+	const GLfloat *zs, size_t nz, bool allowEarly, GLfloat level, GLfloat *out) {
+	// map each axis once instead of once per sample
+	std::vector<GLfloat> mx(nx), my(ny), mz(nz);
+	GLfloat lowest = 0;
+	for (size_t i = 0; i < nx; ++i) {
+		mx[i] = map(xs[i]) + x_off;
+		lowest = std::min(lowest, mx[i]);
+	}
+	for (size_t j = 0; j < ny; ++j) {
+		my[j] = map(ys[j]) + y_off;
+		lowest = std::min(lowest, my[j]);
+	}
+	for (size_t k = 0; k < nz; ++k) {
+		mz[k] = map(zs[k]) + z_off;
+		lowest = std::min(lowest, mz[k]);
+	}
+
+	// the octave bounds early termination relies on only hold for coordinates >= 0,
+	// except with simplex noise which keeps within them everywhere
+	bool stopEarly = allowEarly && (lowest >= 0 || basis == NOISE_SIMPLEX);
+	if (basis == NOISE_SIMPLEX) {
+		fillRows<Simplex, double>(sn, fbm, stopEarly, level, mx, my, mz, out);
+	}
+	else if (precision == NOISE_FLOAT) {
+		fillRows<NoiseF, float>(pnf, fbm, stopEarly, level, mx, my, mz, out);
+	}
+	else {
+		fillRows<Noise, double>(pn, fbm, stopEarly, level, mx, my, mz, out);
+	}
+}
+
+GLfloat PerlinFunc::getIso() const {
+	return iso;
+}
+
+void PerlinFunc::setIso(GLfloat iso) {
+	this->iso = iso;
+}
+
+void PerlinFunc::setOctaves(int octaves, GLfloat persistence) {
+	this->fbm = Fbm(octaves, persistence);
+}
+
+int PerlinFunc::getOctaves() const {
+	return fbm.getOctaves();
+}
+
+void PerlinFunc::setEarlyTermination(bool earlyTermination) {
+	this->earlyTermination = earlyTermination;
+}
+
 GLfloat PerlinFunc::map(GLfloat val) {
 	return bmin + (bmax - bmin) * (val - amin) / (amax - amin);
 }
 
+GLfloat PerlinFunc::offsetScale() const {
+	return (amax - amin) / (bmax - bmin);
+}
+
 void PerlinFunc::incXoff(float inc) {
 	this->x_off += inc;
 }
@@ -1,11 +1,26 @@
 #include "ImplicitFunc.h"
 #include "Noise.h"
+#include "NoiseF.h"
+#include "Simplex.h"
+#include "Fbm.h"
 #define GLEW_STATIC
 #include <GL/glew.h>
 
 #ifndef PERLINFUNC_H
 #define PERLINFUNC_H
 
+// NOISE_FLOAT trades up to NOISEF_MAX_ERROR of accuracy for wider vector lanes
+enum NoisePrecision {
+	NOISE_DOUBLE,
+	NOISE_FLOAT
+};
+
+// NOISE_SIMPLEX sums 4 lattice corners per sample instead of 8. It is a
+// different field with the same range, and is always evaluated in double
+enum NoiseBasis {
+	NOISE_PERLIN,
+	NOISE_SIMPLEX
+};
 
 class PerlinFunc: public ImplicitFunc {
 private:
@@ -16,8 +31,16 @@ private:
 	GLfloat z_off;
 
 	Noise pn;
+	NoiseF pnf;
+	Simplex sn;
+	NoiseBasis basis;
+	NoisePrecision precision;
+	Fbm fbm;
+	bool earlyTermination;
 
 	GLfloat map(GLfloat val);
+	void fillBlock(const GLfloat *xs, size_t nx, const GLfloat *ys, size_t ny,
+		const GLfloat *zs, size_t nz, bool allowEarly, GLfloat level, GLfloat *out);
 
 public:
 	GLfloat amin;
@@ -25,9 +48,37 @@ public:
 	GLfloat bmin;
 	GLfloat bmax;
 
-	PerlinFunc(GLfloat iso, GLfloat amin, GLfloat amax, GLfloat bmin, GLfloat bmax);
+	PerlinFunc(GLfloat iso, GLfloat amin, GLfloat amax, GLfloat bmin, GLfloat bmax, NoiseBasis basis = NOISE_PERLIN);
 	bool isInside(GLfloat x, GLfloat y, GLfloat z);
 	GLfloat function(GLfloat x, GLfloat y, GLfloat z);
+	void evaluateBlock(const GLfloat *xs, size_t nx, const GLfloat *ys, size_t ny,
+		const GLfloat *zs, size_t nz, GLfloat *out);
+	GLfloat gradient(GLfloat x, GLfloat y, GLfloat z, GLfloat grad[3]);
+	// from lattice cell intervals for Perlin noise at coordinates >= 0,
+	// otherwise the range of the noise for simplex and none for Perlin
+	void bounds(const GLfloat lo[3], const GLfloat hi[3], GLfloat &min, GLfloat &max);
+
+	void evaluatePoints(const GLfloat *x, const GLfloat *y, const GLfloat *z, GLfloat *out, size_t count);
+
+	// the noise before iso is subtracted, always with every octave summed
+	void evaluateRawBlock(const GLfloat *xs, size_t nx, const GLfloat *ys, size_t ny,
+		const GLfloat *zs, size_t nz, GLfloat *out);
+	GLfloat getIso() const;
+	void setIso(GLfloat iso);
+
+	NoiseBasis getBasis() const;
+	void setPrecision(NoisePrecision precision);
+	NoisePrecision getPrecision() const;
+
+	// sum octaves of noise as Noise::octave does; one octave is plain noise
+	void setOctaves(int octaves, GLfloat persistence);
+	int getOctaves() const;
+	// let evaluateBlock stop summing octaves once a sample's side of iso is
+	// settled. Signs stay exact, values away from the surface do not
+	void setEarlyTermination(bool earlyTermination);
+
+	// the domain [amin, amax] covers [bmin, bmax] of noise
+	GLfloat offsetScale() const;
 
 	void incXoff(float inc);
 	void incYoff(float inc);
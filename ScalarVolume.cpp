@@ -0,0 +1,173 @@
+#include "ScalarVolume.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+static const size_t ALIGNMENT = 64;
+static const std::uint64_t ALL_INSIDE = 0x0101010101010101ull;
+
+ScalarVolume::ScalarVolume() : block(nullptr), values(nullptr), inside(nullptr) {
+	allocate(0, 0, 0);
+}
+
+ScalarVolume::ScalarVolume(size_t nx, size_t ny, size_t nz) : block(nullptr), values(nullptr), inside(nullptr) {
+	allocate(nx, ny, nz);
+}
+
+ScalarVolume::ScalarVolume(const ScalarVolume &volume) : block(nullptr), values(nullptr), inside(nullptr) {
+	allocate(volume.nx, volume.ny, volume.nz);
+	std::memcpy(values, volume.values, size() * sizeof(GLfloat));
+	std::memcpy(inside, volume.inside, size());
+}
+
+ScalarVolume::~ScalarVolume() {
+	release();
+}
+
+ScalarVolume &ScalarVolume::operator=(const ScalarVolume &volume) {
+	if (this != &volume) {
+		resize(volume.nx, volume.ny, volume.nz);
+		std::memcpy(values, volume.values, size() * sizeof(GLfloat));
+		std::memcpy(inside, volume.inside, size());
+	}
+	return *this;
+}
+
+void ScalarVolume::resize(size_t nx, size_t ny, size_t nz) {
+	if (nx == this->nx && ny == this->ny && nz == this->nz) {
+		return;
+	}
+	release();
+	allocate(nx, ny, nz);
+}
+
+void ScalarVolume::setBorder(GLfloat value, bool inside) {
+	if (nx == 0 || ny == 0 || nz == 0) {
+		return;
+	}
+	for (size_t a = 0; a < ny; ++a) {
+		for (size_t b = 0; b < nz; ++b) {
+			setSample(0, a, b, value, inside);
+			setSample(nx - 1, a, b, value, inside);
+		}
+	}
+	for (size_t a = 0; a < nx; ++a) {
+		for (size_t b = 0; b < nz; ++b) {
+			setSample(a, 0, b, value, inside);
+			setSample(a, ny - 1, b, value, inside);
+		}
+	}
+	for (size_t a = 0; a < nx; ++a) {
+		for (size_t b = 0; b < ny; ++b) {
+			setSample(a, b, 0, value, inside);
+			setSample(a, b, nz - 1, value, inside);
+		}
+	}
+}
+
+// copy the samples of i-slice from over i-slice to
+void ScalarVolume::copySlice(size_t from, size_t to) {
+	std::memcpy(values + to * sx, values + from * sx, sx * sizeof(GLfloat));
+	std::memcpy(inside + to * sx, inside + from * sx, sx);
+}
+
+// a sample is inside where the field is negative, the same test the
+// implicit functions make in isInside
+void ScalarVolume::classifyRow(size_t i, size_t j) {
+	size_t n = index(i, j, 0);
+	for (size_t k = 0; k < nz; ++k, ++n) {
+		inside[n] = values[n] < 0;
+	}
+}
+
+void ScalarVolume::allocate(size_t nx, size_t ny, size_t nz) {
+	this->nx = nx;
+	this->ny = ny;
+	this->nz = nz;
+	this->sy = nz;
+	this->sx = ny * nz;
+
+	// corner order matches the byteArray layout the aCases table was built for
+	cornerOffset[0] = 0;
+	cornerOffset[1] = sx;
+	cornerOffset[2] = sx + 1;
+	cornerOffset[3] = 1;
+	cornerOffset[4] = sy;
+	cornerOffset[5] = sx + sy;
+	cornerOffset[6] = sx + sy + 1;
+	cornerOffset[7] = sy + 1;
+
+	size_t count = nx * ny * nz;
+	if (count == 0) {
+		return;
+	}
+
+	// values first, flags packed behind them, padded so both start on a cache line
+	size_t valueBytes = (count * sizeof(GLfloat) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	block = new unsigned char[valueBytes + count + ALIGNMENT];
+	unsigned char *base = block + (ALIGNMENT - reinterpret_cast<std::uintptr_t>(block) % ALIGNMENT) % ALIGNMENT;
+	values = reinterpret_cast<GLfloat *>(base);
+	inside = base + valueBytes;
+}
+
+void ScalarVolume::release() {
+	delete[] block;
+	block = nullptr;
+	values = nullptr;
+	inside = nullptr;
+}
+
+BrickMap::BrickMap(size_t nx, size_t ny, size_t nz) {
+	size_t size[3] = { nx, ny, nz };
+	for (int axis = 0; axis < 3; ++axis) {
+		this->samples[axis] = size[axis];
+		this->bricks[axis] = bricksAlong(size[axis]);
+	}
+	this->crossed.assign(bricks[0] * bricks[1] * bricks[2], 0);
+}
+
+// Brick b holds cells [b * BRICK, (b + 1) * BRICK) and the samples at both
+// ends of them. Each row is reduced to the lowest and highest inside flag per
+// brick along k, and folded into the one or two bricks along j that hold it.
+void BrickMap::summarizeSlab(const ScalarVolume &vals, size_t bi) {
+	size_t by = bricks[1];
+	size_t bz = bricks[2];
+	std::vector<unsigned char> lo(by * bz, 1);
+	std::vector<unsigned char> hi(by * bz, 0);
+
+	size_t iEnd = std::min((bi + 1) * BRICK, samples[0] - 1);
+	for (size_t i = bi * BRICK; i <= iEnd; ++i) {
+		for (size_t j = 0; j < samples[1]; ++j) {
+			size_t bjLast = std::min(j / BRICK, by - 1);
+			size_t bjFirst = j % BRICK == 0 && j > 0 ? j / BRICK - 1 : bjLast;
+			const unsigned char *row = vals.insideRow(i, j);
+			for (size_t bk = 0; bk < bz; ++bk) {
+				size_t kEnd = std::min((bk + 1) * BRICK, samples[2] - 1);
+				unsigned char rowLo = row[kEnd];
+				unsigned char rowHi = row[kEnd];
+				size_t k = bk * BRICK;
+				if (kEnd - k == sizeof(std::uint64_t)) {
+					// flags are 0 or 1, so a whole brick row is one word to test
+					std::uint64_t word;
+					std::memcpy(&word, row + k, sizeof(word));
+					rowLo &= word == ALL_INSIDE;
+					rowHi |= word != 0;
+				}
+				else {
+					for (; k < kEnd; ++k) {
+						rowLo &= row[k];
+						rowHi |= row[k];
+					}
+				}
+				for (size_t bj = bjFirst; bj <= bjLast; ++bj) {
+					lo[bj * bz + bk] &= rowLo;
+					hi[bj * bz + bk] |= rowHi;
+				}
+			}
+		}
+	}
+
+	for (size_t n = 0; n < by * bz; ++n) {
+		crossed[bi * by * bz + n] = lo[n] != hi[n];
+	}
+}
@@ -0,0 +1,131 @@
+#include <cstddef>
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#ifndef SCALARVOLUME_H
+#define SCALARVOLUME_H
+
+// Dense nx * ny * nz lattice of implicit function samples.
+// Values and inside flags live in one 64-byte aligned block, laid out with k
+// fastest, then j, then i, so every neighbour of a sample is a fixed offset away.
+class ScalarVolume {
+public:
+	ScalarVolume();
+	ScalarVolume(size_t nx, size_t ny, size_t nz);
+	ScalarVolume(const ScalarVolume &volume);
+	~ScalarVolume();
+
+	ScalarVolume &operator=(const ScalarVolume &volume);
+
+	void resize(size_t nx, size_t ny, size_t nz);
+	void setBorder(GLfloat value, bool inside);
+	void copySlice(size_t from, size_t to);
+
+	// derive the inside flags of row (i, j) from the sign of its values
+	void classifyRow(size_t i, size_t j);
+
+	size_t getNx() const { return nx; }
+	size_t getNy() const { return ny; }
+	size_t getNz() const { return nz; }
+	size_t size() const { return nx * ny * nz; }
+
+	// offsets to step one sample along i, j or k
+	size_t strideI() const { return sx; }
+	size_t strideJ() const { return sy; }
+
+	size_t index(size_t i, size_t j, size_t k) const {
+		return i * sx + j * sy + k;
+	}
+
+	GLfloat value(size_t i, size_t j, size_t k) const {
+		return values[index(i, j, k)];
+	}
+
+	bool isInside(size_t i, size_t j, size_t k) const {
+		return inside[index(i, j, k)] != 0;
+	}
+
+	void setSample(size_t i, size_t j, size_t k, GLfloat value, bool isInside) {
+		size_t n = index(i, j, k);
+		values[n] = value;
+		inside[n] = isInside;
+	}
+
+	void setInside(size_t i, size_t j, size_t k, bool isInside) {
+		inside[index(i, j, k)] = isInside;
+	}
+
+	// values of sample (i, j, 0) onwards, for filling a row or slice in place
+	GLfloat *row(size_t i, size_t j) {
+		return values + index(i, j, 0);
+	}
+
+	// inside flags of sample (i, j, 0) onwards, for scanning a row
+	const unsigned char *insideRow(size_t i, size_t j) const {
+		return inside + index(i, j, 0);
+	}
+
+	// neighbouring sample of idx in the cell corner order used by aCases
+	size_t neighbour(size_t idx, int corner) const {
+		return idx + cornerOffset[corner];
+	}
+
+	// aCases index of cell (i, j, k): bit n is set when corner n is inside
+	int cubeIndex(size_t i, size_t j, size_t k) const {
+		const unsigned char *c = inside + index(i, j, k);
+		return c[cornerOffset[0]] | c[cornerOffset[1]] << 1 | c[cornerOffset[2]] << 2 | c[cornerOffset[3]] << 3
+			| c[cornerOffset[4]] << 4 | c[cornerOffset[5]] << 5 | c[cornerOffset[6]] << 6 | c[cornerOffset[7]] << 7;
+	}
+
+	void cornerValues(size_t i, size_t j, size_t k, GLfloat out[8]) const {
+		const GLfloat *c = values + index(i, j, k);
+		for (int n = 0; n < 8; ++n) {
+			out[n] = c[cornerOffset[n]];
+		}
+	}
+
+private:
+	size_t nx, ny, nz;
+	size_t sx, sy;
+	size_t cornerOffset[8];
+
+	unsigned char *block;
+	GLfloat *values;
+	unsigned char *inside;
+
+	void allocate(size_t nx, size_t ny, size_t nz);
+	void release();
+};
+// Which bricks of BRICK^3 cells of a ScalarVolume hold both inside and outside
+// samples. Bricks share the samples on their faces, so an edge joining an inside
+// and an outside sample lies in a crossed brick, and the cell passes can skip
+// every other brick: its cells are all inside or all outside.
+class BrickMap {
+public:
+	static const size_t BRICK = 8;
+
+	BrickMap(size_t nx, size_t ny, size_t nz);
+
+	// bricks along an axis of samples samples
+	static size_t bricksAlong(size_t samples) {
+		return samples < 2 ? 0 : (samples - 2) / BRICK + 1;
+	}
+
+	// bricks along axis
+	size_t count(int axis) const { return bricks[axis]; }
+
+	// record which bricks in slab bi of vals are crossed
+	void summarizeSlab(const ScalarVolume &vals, size_t bi);
+
+	bool isCrossed(size_t bi, size_t bj, size_t bk) const {
+		return crossed[(bi * bricks[1] + bj) * bricks[2] + bk] != 0;
+	}
+
+private:
+	size_t samples[3];
+	size_t bricks[3];
+	std::vector<unsigned char> crossed;
+};
+
+#endif
@@ -0,0 +1,153 @@
+#include "Simplex.h"
+#include "Noise.h"
+#include "NoiseSIMD.h"
+
+// skew into and back out of the simplex lattice
+static const double F3 = 1.0 / 3.0;
+static const double G3 = 1.0 / 6.0;
+static const double F4 = 0.30901699437494745;	// (sqrt(5) - 1) / 4
+static const double G4 = 0.1381966011250105;	// (5 - sqrt(5)) / 20
+
+static int fastFloor(double x) {
+	int xi = (int)x;
+	return x < xi ? xi - 1 : xi;
+}
+
+// A corner's share falls off as (0.5 - r^2)^4 and is zero beyond it. The
+// 0.6 often used instead reaches past the opposite face and leaves seams.
+// The 3D gradients are the 12 edge directions Noise::grad picks from hash & 15.
+static double corner3(int hash, double x, double y, double z) {
+	double t = 0.5 - x * x - y * y - z * z;
+	t = t < 0 ? 0 : t;
+	t *= t;
+	int h = hash & 15;
+	double u = h < 8 ? x : y;
+	double v = h < 4 ? y : (h == 12 || h == 14 ? x : z);
+	return t * t * (((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v));
+}
+
+// the 4D gradients are the 32 edge directions of the tesseract: hash & 31
+// picks the zero component in its top two bits and the signs in the low three
+static double corner4(int hash, double x, double y, double z, double w) {
+	double t = 0.5 - x * x - y * y - z * z - w * w;
+	t = t < 0 ? 0 : t;
+	t *= t;
+	int h = hash & 31;
+	double u = h < 24 ? x : y;
+	double v = h < 16 ? y : z;
+	double c = h < 8 ? z : w;
+	return t * t * (((h & 1) == 0 ? u : -u) + ((h & 2) == 0 ? v : -v) + ((h & 4) == 0 ? c : -c));
+}
+
+Simplex::Simplex() {
+	const int *table = Noise().getTable();
+	for (int x = 0; x < 512; x++) {
+		p[x] = table[x];
+	}
+}
+
+double Simplex::noise(double x, double y, double z) {
+	// the cell of the skewed lattice, and the offset from its origin
+	double s = (x + y + z) * F3;
+	int i = fastFloor(x + s);
+	int j = fastFloor(y + s);
+	int k = fastFloor(z + s);
+	double t = (i + j + k) * G3;
+	double x0 = x - (i - t);
+	double y0 = y - (j - t);
+	double z0 = z - (k - t);
+
+	// which of the six tetrahedra of the cell holds the point: the second
+	// corner steps along the largest offset, the third along the two largest
+	bool xy = x0 >= y0, xz = x0 >= z0, yz = y0 >= z0;
+	int i1 = xy && xz, j1 = !xy && yz, k1 = !xz && !yz;
+	int i2 = xy || xz, j2 = !xy || yz, k2 = !xz || !yz;
+
+	double x1 = x0 - i1 + G3, y1 = y0 - j1 + G3, z1 = z0 - k1 + G3;
+	double x2 = x0 - i2 + 2 * G3, y2 = y0 - j2 + 2 * G3, z2 = z0 - k2 + 2 * G3;
+	double x3 = x0 - 1 + 3 * G3, y3 = y0 - 1 + 3 * G3, z3 = z0 - 1 + 3 * G3;
+
+	int ii = i & 255;
+	int jj = j & 255;
+	int kk = k & 255;
+	double n = corner3(p[ii + p[jj + p[kk]]], x0, y0, z0)
+		+ corner3(p[ii + i1 + p[jj + j1 + p[kk + k1]]], x1, y1, z1)
+		+ corner3(p[ii + i2 + p[jj + j2 + p[kk + k2]]], x2, y2, z2)
+		+ corner3(p[ii + 1 + p[jj + 1 + p[kk + 1]]], x3, y3, z3);
+
+	// the sum peaks just above 0.013; scale it to within [-1, 1]
+	return (76 * n + 1) / 2;
+}
+
+double Simplex::noise(double x, double y, double z, double w) {
+	double s = (x + y + z + w) * F4;
+	int i = fastFloor(x + s);
+	int j = fastFloor(y + s);
+	int k = fastFloor(z + s);
+	int l = fastFloor(w + s);
+	double t = (i + j + k + l) * G4;
+	double x0 = x - (i - t);
+	double y0 = y - (j - t);
+	double z0 = z - (k - t);
+	double w0 = w - (l - t);
+
+	// rank the offsets; the simplex steps along the largest first
+	int rankx = (x0 > y0) + (x0 > z0) + (x0 > w0);
+	int ranky = (x0 <= y0) + (y0 > z0) + (y0 > w0);
+	int rankz = (x0 <= z0) + (y0 <= z0) + (z0 > w0);
+	int rankw = (x0 <= w0) + (y0 <= w0) + (z0 <= w0);
+
+	int step[3][4];
+	for (int c = 0; c < 3; ++c) {
+		step[c][0] = rankx >= 3 - c ? 1 : 0;
+		step[c][1] = ranky >= 3 - c ? 1 : 0;
+		step[c][2] = rankz >= 3 - c ? 1 : 0;
+		step[c][3] = rankw >= 3 - c ? 1 : 0;
+	}
+
+	int ii = i & 255;
+	int jj = j & 255;
+	int kk = k & 255;
+	int ll = l & 255;
+	double n = corner4(p[ii + p[jj + p[kk + p[ll]]]], x0, y0, z0, w0);
+	for (int c = 0; c < 3; ++c) {
+		double g = (c + 1) * G4;
+		int hash = p[ii + step[c][0] + p[jj + step[c][1] + p[kk + step[c][2] + p[ll + step[c][3]]]]];
+		n += corner4(hash, x0 - step[c][0] + g, y0 - step[c][1] + g, z0 - step[c][2] + g, w0 - step[c][3] + g);
+	}
+	int hash = p[ii + 1 + p[jj + 1 + p[kk + 1 + p[ll + 1]]]];
+	n += corner4(hash, x0 - 1 + 4 * G4, y0 - 1 + 4 * G4, z0 - 1 + 4 * G4, w0 - 1 + 4 * G4);
+
+	// 27 scales the sum to about [-1, 1]
+	// the sum peaks just below 0.016
+	return (62 * n + 1) / 2;
+}
+
+void Simplex::noise(const double *x, const double *y, const double *z, double *out, size_t count) {
+	for (size_t n = simplexSIMD(p, x, y, z, out, count); n < count; ++n) {
+		out[n] = noise(x[n], y[n], z[n]);
+	}
+}
+
+void Simplex::noise(const double *x, const double *y, const double *z, double w, double *out, size_t count) {
+	for (size_t n = simplexSIMD(p, x, y, z, w, out, count); n < count; ++n) {
+		out[n] = noise(x[n], y[n], z[n], w);
+	}
+}
+
+double Simplex::octave(double x, double y, double z, int octaves, double persistence) {
+	double total = 0;
+	double frequency = 1;
+	double amplitude = 1;
+	double maxValue = 0;
+	for (int i = 0;i<octaves;i++) {
+		total += noise(x * frequency, y * frequency, z * frequency) * amplitude;
+
+		maxValue += amplitude;
+
+		amplitude *= persistence;
+		frequency *= 2;
+	}
+
+	return total / maxValue;
+}
@@ -0,0 +1,26 @@
+#include <cstddef>
+
+#ifndef SIMPLEX_H
+#define SIMPLEX_H
+
+// Simplex noise in 3 and 4 dimensions on the permutation table of Noise.
+// A 3D sample sums 4 corner contributions and a 4D one 5, against the 8 of
+// Noise::noise. Like Noise, values are scaled into about [0, 1], with 0.5 as
+// the mean, so either can drive the same iso level.
+class Simplex {
+private:
+	int p[512];
+	int pMod12[512];
+
+public:
+	Simplex();
+	double noise(double x, double y, double z);
+	double noise(double x, double y, double z, double w);
+	// noise of count points, for the batch callers of Noise
+	void noise(const double *x, const double *y, const double *z, double *out, size_t count);
+	// 4D noise of count points that share the same w, as a field at time w
+	void noise(const double *x, const double *y, const double *z, double w, double *out, size_t count);
+	double octave(double x, double y, double z, int octaves, double persistence);
+};
+
+#endif
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "SphereFunc.h"
 
 SphereFunc::SphereFunc(GLfloat r) {
@@ -8,8 +9,42 @@ GLfloat SphereFunc::function(GLfloat x, GLfloat y, GLfloat z) {
 	return x*x + y*y + z*z - r*r;
 }
 
+void SphereFunc::evaluateBlock(const GLfloat *xs, size_t nx, const GLfloat *ys, size_t ny,
+	const GLfloat *zs, size_t nz, GLfloat *out) {
+	for (size_t i = 0; i < nx; ++i) {
+		GLfloat xx = xs[i] * xs[i];
+		for (size_t j = 0; j < ny; ++j) {
+			GLfloat xy = xx + ys[j] * ys[j];
+			for (size_t k = 0; k < nz; ++k) {
+				*out++ = xy + zs[k] * zs[k] - r*r;
+			}
+		}
+	}
+}
+
+GLfloat SphereFunc::gradient(GLfloat x, GLfloat y, GLfloat z, GLfloat grad[3]) {
+	grad[0] = 2 * x;
+	grad[1] = 2 * y;
+	grad[2] = 2 * z;
+	return function(x, y, z);
+}
+
+// exact: each square is lowest at the point of its range nearest 0 and highest
+// at the end farthest from it, summed in the order evaluateBlock sums them
+void SphereFunc::bounds(const GLfloat lo[3], const GLfloat hi[3], GLfloat &min, GLfloat &max) {
+	GLfloat low[3], high[3];
+	for (int axis = 0; axis < 3; ++axis) {
+		GLfloat a = lo[axis] * lo[axis];
+		GLfloat b = hi[axis] * hi[axis];
+		low[axis] = lo[axis] <= 0 && hi[axis] >= 0 ? 0 : std::min(a, b);
+		high[axis] = std::max(a, b);
+	}
+	min = low[0] + low[1] + low[2] - r*r;
+	max = high[0] + high[1] + high[2] - r*r;
+}
+
 bool SphereFunc::isInside(GLfloat x, GLfloat y, GLfloat z) {
-	return function(x, y, z) <= 0;
+	return function(x, y, z) < 0;
 }
 
 void SphereFunc::incXoff(float inc) {}
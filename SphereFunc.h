@@ -10,6 +10,10 @@ public:
 	SphereFunc(GLfloat r);
 	bool isInside(GLfloat x, GLfloat y, GLfloat z);
 	GLfloat function(GLfloat x, GLfloat y, GLfloat z);
+	void evaluateBlock(const GLfloat *xs, size_t nx, const GLfloat *ys, size_t ny,
+		const GLfloat *zs, size_t nz, GLfloat *out);
+	GLfloat gradient(GLfloat x, GLfloat y, GLfloat z, GLfloat grad[3]);
+	void bounds(const GLfloat lo[3], const GLfloat hi[3], GLfloat &min, GLfloat &max);
 	
 	void incXoff(float inc);
 	void incYoff(float inc);
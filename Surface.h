@@ -0,0 +1,24 @@
+#include <vector>
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#ifndef SURFACE_H
+#define SURFACE_H
+
+// vertex number that stands for no vertex
+const GLuint NO_VERTEX = 0xFFFFFFFF;
+
+// Indexed triangle mesh produced by the extractors.
+// vertices stores each unique vertex once as {x0, y0, z0, x1, y1, z1, ...}
+// and indices stores three vertex numbers per triangle.
+// normals holds a unit normal per vertex, in the same layout as vertices.
+struct Surface {
+	std::vector<GLfloat> vertices;
+	std::vector<GLfloat> normals;
+	std::vector<GLuint> indices;
+
+	size_t vertexCount() const { return vertices.size() / 3; }
+	size_t triangleCount() const { return indices.size() / 3; }
+};
+
+#endif
@@ -0,0 +1,92 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int threads) : job(nullptr), next(0), jobEnd(0), busy(0), generation(0), stopping(false) {
+	if (threads <= 0) {
+		threads = (int)std::thread::hardware_concurrency();
+	}
+	for (int n = 1; n < threads; ++n) {
+		workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (size_t n = 0; n < workers.size(); ++n) {
+		workers[n].join();
+	}
+}
+
+int ThreadPool::size() const {
+	return (int)workers.size() + 1;
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, const std::function<void(size_t)> &body) {
+	if (end <= begin) {
+		return;
+	}
+	if (workers.empty() || end - begin == 1) {
+		for (size_t n = begin; n < end; ++n) {
+			body(n);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		job = &body;
+		next = begin;
+		jobEnd = end;
+		busy = workers.size();
+		++generation;
+	}
+	wake.notify_all();
+
+	runJob();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	done.wait(lock, [this] { return busy == 0; });
+	job = nullptr;
+}
+
+void ThreadPool::workerLoop() {
+	unsigned seen = 0;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+			if (stopping) {
+				return;
+			}
+			seen = generation;
+		}
+
+		runJob();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--busy == 0) {
+				done.notify_one();
+			}
+		}
+	}
+}
+
+void ThreadPool::runJob() {
+	for (size_t n = next++; n < jobEnd; n = next++) {
+		(*job)(n);
+	}
+}
+
+void parallelFor(ThreadPool *pool, size_t count, const std::function<void(size_t)> &body) {
+	if (pool == nullptr) {
+		for (size_t n = 0; n < count; ++n) {
+			body(n);
+		}
+		return;
+	}
+	pool->parallelFor(0, count, body);
+}
@@ -0,0 +1,51 @@
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+// Fixed set of worker threads for data parallel loops.
+// parallelFor hands out loop indices one at a time and the calling thread
+// works alongside the pool, so a pool of n threads starts n - 1 workers.
+// Calls must not be nested or made from two threads at once.
+class ThreadPool {
+public:
+	// threads <= 0 uses every hardware thread
+	ThreadPool(int threads);
+	~ThreadPool();
+
+	int size() const;
+
+	// run body(n) for every n in [begin, end) and return once all have finished
+	void parallelFor(size_t begin, size_t end, const std::function<void(size_t)> &body);
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+
+	const std::function<void(size_t)> *job;
+	std::atomic<size_t> next;
+	size_t jobEnd;
+	size_t busy;
+	unsigned generation;
+	bool stopping;
+
+	ThreadPool(const ThreadPool &pool);
+	ThreadPool &operator=(const ThreadPool &pool);
+
+	void workerLoop();
+	void runJob();
+};
+
+// run body(n) for every n in [0, count), across pool when there is one and
+// on the calling thread alone when pool is null
+void parallelFor(ThreadPool *pool, size_t count, const std::function<void(size_t)> &body);
+
+#endif
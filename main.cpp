@@ -1,7 +1,10 @@
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <cmath>
+#include <limits>
 #include <memory>
-#include <map>
+#include <random>
 #include <string>
 #define _USE_MATH_DEFINES
 
@@ -13,53 +16,102 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#include "LUTable.h"
 #include "mesh.h"
 #include "Shader.h"
 #include "Noise.h"
+#include "Simplex.h"
+#include "Fbm.h"
 #include "cimg.h"
 
 #include "PerlinFunc.h"
+#include "AnimatedFunc.h"
 #include "SphereFunc.h"
 #include "UFGenerator.h"
 #include "SurfaceData.h"
-
-struct HKey {
-	int a;
-	int b;
-	int c;
-	int d;
-	int e;
-	int f;
-};
-
-bool operator<(HKey const & lhs, HKey const & rhs) {
-	return std::tie(lhs.a, lhs.b, lhs.c, lhs.d, lhs.e, lhs.f) < std::tie(rhs.a, rhs.b, rhs.c, rhs.d, rhs.e, rhs.f);
-}
+#include "MarchingCubes.h"
+#include "AdaptiveOctree.h"
+#include "Decimation.h"
+#include "DrawOrder.h"
+#include "ChunkManager.h"
+#include "ThreadPool.h"
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
-std::vector<GLfloat> genMesh(std::shared_ptr<ImplicitFunc> function, GLfloat cubeSize);
-std::vector<GLfloat> genUnion(std::shared_ptr<ImplicitFunc> funcA, std::shared_ptr<ImplicitFunc> funcB, GLfloat cubeSize);
-int edgeListIndex(const bool arr[8]);
-std::vector<GLfloat> findVertices(int i, int j, int k, int index, GLfloat* vertex[3], GLfloat*** vals);
-GLfloat interpolate(GLfloat a, GLfloat aVal, GLfloat b, GLfloat bVal);
-
-std::vector<GLfloat> findVerts(int i, int j, int k, int index,
-	GLfloat* vertex[3], std::vector<std::vector<std::vector<GLfloat>>> &vals, std::map<HKey, float> &vert_dic);
-
 const GLint WIDTH = 1000, HEIGHT = 1000;
 int screenWidth, screenHeight;
 void saveFrame();
 
 Mesh current;
 Mesh perlin;
+// the vertex array and buffers current is drawn from
+GLuint VAO, VBO, EBO;
+void uploadCurrent();
 
 UFGenerator ufg;
 
+// 0 samples the field on every hardware thread
+const int MESH_THREADS = 0;
+
+// remesh a morphing field every frame instead of showing one fixed mesh.
+// The resolution follows the time each mesh takes, so that meshing fits
+// in REGEN_SHARE of a frame at TARGET_FPS
+const bool ANIMATE = false;
+// or remesh the startup field at a rising iso level
+const bool ISO_SWEEP = false;
+// or scroll the startup field along x
+const bool FLY_THROUGH = false;
+// mesh the startup field with cells that coarsen away from the camera
+const bool ADAPTIVE = false;
+// collapse the startup mesh down to DECIMATE_SHARE of its triangles
+const bool DECIMATE = false;
+const double DECIMATE_SHARE = 0.25;
+// instead of opening the window, decimate the Perlin field's surface to each
+// share at each resolution and print the triangles reached, error and time
+const bool BENCHMARK_DECIMATION = false;
+const int BENCHMARK_RESOLUTIONS[] = { 50, 100, 150 };
+const double BENCHMARK_SHARES[] = { 0.5, 0.25, 0.1 };
+// or check the simplex noise's range and continuity, and exit with failure
+// when a sample leaves the range or it jumps between simplices
+const bool CHECK_NOISE = false;
+const int NOISE_CHECK_SAMPLES = 1000000;
+// steepest slope allowed across a face, against about 4 over the noise as a whole
+const double NOISE_MAX_SLOPE = 20;
+// reorder the triangles and vertices of every mesh for the GPU before upload
+const bool OPTIMIZE_DRAW_ORDER = true;
+// or fly through the unbounded noise, meshed in chunks around the camera.
+// Perlin noise wants coordinates >= 0, so the flight starts well inside them
+const bool CHUNKED = false;
+const GLfloat CHUNK_SIZE = 0.5f;
+const GLint CHUNK_RESOLUTION = 17;
+const GLint VIEW_RADIUS = 6;
+const size_t CHUNK_BUDGET = 256 * 1024 * 1024;
+const int CHUNK_UPLOADS = 4;
+const GLfloat FLY_START = 32.0f;
+const GLfloat FLY_SPEED = 0.5f;
+const double TARGET_FPS = 30;
+const double REGEN_SHARE = 0.75;
+const double ANIMATION_SPEED = 0.25;
+const int MIN_RESOLUTION = 16;
+const int MAX_RESOLUTION = 150;
+int fitResolution(int resolution, double seconds, double budget);
+void showSurface(Surface surface);
+void reportDrawOrder(const char *what, const CacheStats &before, const CacheStats &after);
+void benchmarkDecimation();
+void surfaceError(ImplicitFunc &function, const Surface &surface, double &mean, double &max);
+bool checkNoise();
+double slopeAcrossFace(Simplex &simplex, int dimensions, double point[4], std::mt19937 &random);
+
 float frame_count = 0;
 float dr = 2 * M_PI / 360.0;
 
 int main() {
+	if (BENCHMARK_DECIMATION) {
+		benchmarkDecimation();
+		return EXIT_SUCCESS;
+	}
+	if (CHECK_NOISE) {
+		return checkNoise() ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
 	glfwInit();
 
 	// set the version of openGL to 3.3
@@ -108,27 +160,67 @@ int main() {
 	Shader ourShader("core.vert", "core.frag");
 
 	// create perlin noise mesh
+	ThreadPool pool(MESH_THREADS);
 	float dim = 1.5;
 	std::shared_ptr<ImplicitFunc> perlinFunc = (std::shared_ptr<ImplicitFunc>) (new PerlinFunc(0.5, -dim, dim, 0.0, 4));
 	std::shared_ptr<ImplicitFunc> sphereFunc = (std::shared_ptr<ImplicitFunc>) (new SphereFunc(1.4));
 
-	//std::vector<GLfloat> perlinVertices = genMesh(perlinFunc, dim);
-	std::vector<GLfloat> perlinVertices = genUnion(perlinFunc, sphereFunc, dim);
+	ExtractionConfig config(dim, 100);
+	ExtractionEstimate estimate = estimateExtraction(perlinFunc, sphereFunc, config, pool.size());
+	std::cout << "meshing " << estimate.samples << " samples, expecting ~" << estimate.triangles << " triangles, "
+		<< estimate.peakBytes / (1024 * 1024) << " MB peak, " << estimate.seconds << " s" << std::endl;
+
+	//Surface perlinSurface = genMesh(perlinFunc, ExtractionConfig(dim, 50), &pool);
+	Surface perlinSurface;
+	if (ADAPTIVE) {
+		AdaptiveSettings settings;
+		std::fill(settings.viewpoint, settings.viewpoint + 3, 3.0f);
+		settings.lodDistance = 2;
+		perlinSurface = adaptiveUnion(perlinFunc, sphereFunc, config, settings, &pool);
+	}
+	else {
+		perlinSurface = genUnion(perlinFunc, sphereFunc, config, &pool);
+	}
+	std::cout << "mesh complete: " << perlinSurface.triangleCount() << " triangles" << std::endl;
+	if (DECIMATE) {
+		DecimationSettings settings;
+		settings.targetTriangles = (size_t)(perlinSurface.triangleCount() * DECIMATE_SHARE);
+		// the share alone decides where to stop, so the error is left unbounded
+		settings.maxError = std::numeric_limits<GLfloat>::max();
+		perlinSurface = decimateSurface(perlinSurface, settings);
+	}
+	if (OPTIMIZE_DRAW_ORDER) {
+		CacheStats before = simulateVertexCache(perlinSurface);
+		optimizeDrawOrder(perlinSurface);
+		reportDrawOrder("mesh", before, simulateVertexCache(perlinSurface));
+	}
 	perlin = Mesh(0.4f, 0.4f, 0.4f);
-	perlin.setVPositions(perlinVertices);
-	perlin.genVNormals();
+	perlin.setVPositions(perlinSurface.vertices);
+	perlin.setVIndices(perlinSurface.indices);
+	perlin.setVNormals(perlinSurface.normals);
 	perlin.genBuffer();
 
 	// generate mesh
 	current = perlin;
 
+	std::shared_ptr<AnimatedFunc> animatedFunc(new AnimatedFunc(0.5, -dim, dim, 0.0, 4));
+	int animatedResolution = 50;
+
+	std::unique_ptr<CachedExtraction> cache;
+	if (ISO_SWEEP || FLY_THROUGH) {
+		cache.reset(new CachedExtraction(perlinFunc, sphereFunc, config, &pool));
+	}
+
+	std::unique_ptr<ChunkManager> chunks;
+	if (CHUNKED) {
+		chunks.reset(new ChunkManager(perlinFunc, CHUNK_SIZE, CHUNK_RESOLUTION, VIEW_RADIUS, CHUNK_BUDGET, 0, OPTIMIZE_DRAW_ORDER));
+	}
+
 	// create openGL buffer and attribute objects
-	GLuint VBO, VAO;
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	current.bindBuffer();
+	glGenBuffers(1, &EBO);
+	uploadCurrent();
 
 	// create projection transformation
 	glm::mat4 projection;
@@ -143,28 +235,47 @@ int main() {
 
 		ourShader.use();
 
-		// increment perlin offset
-		//perlinFunc->incYoff(0.002);
+		// raise the perlin iso level, remeshing the samples taken at startup
+		if (ISO_SWEEP) {
+			perlinFunc->incYoff(0.002);
+			showSurface(cache->extract());
+		}
 
-		// generate new mesh
-		/*std::vector<GLfloat> perlinVertices = genUnion(perlinFunc, sphereFunc, dim);
-		current = Mesh(0.25f, 0.25f, 0.25f);
-		current.setVPositions(perlinVertices);
-		current.genVNormals();
-		current.genBuffer();
-		current.bindBuffer();*/
+		// move through the noise a lattice cell per frame, sampling only the new plane
+		if (FLY_THROUGH) {
+			cache->scrollX(cache->cellOffset(0));
+			showSurface(cache->extract());
+		}
+
+		// generate new mesh, at the field's shape for the current time
+		if (ANIMATE) {
+			double start = glfwGetTime();
+			animatedFunc->setTime(start * ANIMATION_SPEED);
+			showSurface(genUnion(animatedFunc, sphereFunc, ExtractionConfig(dim, animatedResolution), &pool));
+			animatedResolution = fitResolution(animatedResolution, glfwGetTime() - start, REGEN_SHARE / TARGET_FPS);
+		}
 
 		// set up MVP matrix
 		glm::mat4 model(1.0f);
-
-		//model = glm::rotate(model, (GLfloat)glfwGetTime() * 0.05f, glm::vec3(0.0f, 0.3f, 0.0f));
-		model = glm::rotate(model, (GLfloat) frame_count * dr , glm::vec3(0.0f, 1.0f, 0.0f));
-
-		glm::mat4 view = glm::lookAt(
-			glm::vec3(3, 3, 3), // Camera is at (3,3,3), in World Space
-			glm::vec3(0, 0, 0), // and looks at the origin
-			glm::vec3(0, 1, 0)  // Head is up (set to 0,-1,0 to look upside-down)
-			);
+		glm::mat4 view;
+
+		if (CHUNKED) {
+			GLfloat camera[3] = { FLY_START + (GLfloat)glfwGetTime() * FLY_SPEED, FLY_START, FLY_START };
+			chunks->update(camera);
+			chunks->upload(CHUNK_UPLOADS);
+			glm::vec3 eye(camera[0], camera[1], camera[2]);
+			view = glm::lookAt(eye, eye + glm::vec3(1.0f, -0.2f, 0.3f), glm::vec3(0, 1, 0));
+		}
+		else {
+			//model = glm::rotate(model, (GLfloat)glfwGetTime() * 0.05f, glm::vec3(0.0f, 0.3f, 0.0f));
+			model = glm::rotate(model, (GLfloat) frame_count * dr , glm::vec3(0.0f, 1.0f, 0.0f));
+
+			view = glm::lookAt(
+				glm::vec3(3, 3, 3), // Camera is at (3,3,3), in World Space
+				glm::vec3(0, 0, 0), // and looks at the origin
+				glm::vec3(0, 1, 0)  // Head is up (set to 0,-1,0 to look upside-down)
+				);
+		}
 		glm::mat4 MVP = projection * view * model;
 
 		GLint MVPLoc = glGetUniformLocation(ourShader.Program, "MVP");
@@ -173,9 +284,14 @@ int main() {
 		GLint modelLoc = glGetUniformLocation(ourShader.Program, "model");
 		glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
 
-		glBindVertexArray(VAO);
-		glDrawArrays(GL_TRIANGLES, 0, current.vPositions.size() / 3);
-		glBindVertexArray(0);
+		if (CHUNKED) {
+			chunks->draw();
+		}
+		else {
+			glBindVertexArray(VAO);
+			current.draw();
+			glBindVertexArray(0);
+		}
 
 		glfwSwapBuffers(window);
 		
@@ -185,8 +301,16 @@ int main() {
 		}
 		frame_count++;
 	}
+	if (CHUNKED && OPTIMIZE_DRAW_ORDER) {
+		CacheStats before, after;
+		chunks->drawOrderStats(before, after);
+		reportDrawOrder("chunks", before, after);
+	}
+	// the chunks' vertex arrays go while the context is still there
+	chunks.reset();
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &EBO);
 
 	glfwTerminate();
 
@@ -196,717 +320,183 @@ int main() {
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
 	if (key == GLFW_KEY_1 && action == GLFW_PRESS) {
 		current = perlin;
-		current.bindBuffer();
+		uploadCurrent();
 	}
 }
 
-std::vector<GLfloat> genMesh(std::shared_ptr<ImplicitFunc> function, GLfloat cubeSize) {
-	//std::cout << "generating mesh..." << std::endl;
-	GLfloat minX = -cubeSize;
-	GLfloat minY = -cubeSize;
-	GLfloat minZ = -cubeSize;
-	GLfloat maxX = cubeSize;
-	GLfloat maxY = cubeSize;
-	GLfloat maxZ = cubeSize;
-	GLfloat x, y, z, a;
-	bool byteArray[8];
-
-	const GLint dim = 50;
-
-	bool vertices[dim][dim][dim];
-
-
-	// array of values for x, y, z
-	// vertexCoord[0][] = x's, vertexCoord[1][] = y's, vertex Coord[2][] = z's
-	GLfloat* vertexCoord[3] = { new GLfloat[dim], new GLfloat[dim], new GLfloat[dim] };
-	for (GLint i = 0; i < dim; ++i) {
-		a = ((GLfloat)i / ((GLfloat)dim - 1));
-		x = maxX * a + minX * (1.0f - a);
-		y = maxY * a + minY * (1.0f - a);
-		z = maxZ * a + minZ * (1.0f - a);
-		vertexCoord[0][i] = x;
-		vertexCoord[1][i] = y;
-		vertexCoord[2][i] = z;
-	}
-
-	// vertices stores 0 or 1 depending on whether vertex is inside sphere or not
-	// vertexVals stores the actual value from the implicit function
-	GLfloat*** vertexVals = new GLfloat**[dim];
-	for (GLint i = 0; i < dim; ++i) {
-		vertexVals[i] = new GLfloat*[dim];
-
-		for (GLint j = 0; j < dim; ++j) {
-			vertexVals[i][j] = new GLfloat[dim];
-
-			for (GLint k = 0; k < dim; ++k) {
-				x = vertexCoord[0][i];
-				y = vertexCoord[1][j];
-				z = vertexCoord[2][k];
-				vertices[i][j][k] = function->isInside(x, y, z);
-				vertexVals[i][j][k] = function->function(x, y, z);
-			}
-		}
-	}
-
-	for (GLint i = 0; i < dim; ++i) {
-		for (GLint j = 0; j < dim; ++j) {
-			vertices[0][i][j] = false;
-			vertexVals[0][i][j] = 1000000;
-
-			vertices[dim - 1][i][j] = false;
-			vertexVals[dim - 1][i][j] = 1000000;
-
-			vertices[i][0][j] = false;
-			vertexVals[i][0][j] = 1000000;
-
-			vertices[i][dim - 1][j] = false;
-			vertexVals[i][dim - 1][j] = 1000000;
-			
-			vertices[i][j][0] = false;
-			vertexVals[i][j][0] = 1000000;
-
-			vertices[i][j][dim - 1] = false;
-			vertexVals[i][j][dim - 1] = 1000000;
-		}
-	}
-
-
-	// Go through every cube and check vertices;
-	// triangleVertices stores vertices of facets as {x0, y0, z0, x1, y1, z1, ..., xn, yn, zn}
-	std::vector<GLfloat> triangleVertices;
-	std::vector<GLfloat> temp;
-	for (GLint i = 0; i < dim - 1; ++i) {
-		for (GLint j = 0; j < dim - 1; ++j) {
-			for (GLint k = 0; k < dim - 1; ++k) {
-				byteArray[0] = vertices[i][j][k];
-				byteArray[1] = vertices[i + 1][j][k];
-				byteArray[2] = vertices[i + 1][j][k + 1];
-				byteArray[3] = vertices[i][j][k + 1];
-				byteArray[4] = vertices[i][j + 1][k];
-				byteArray[5] = vertices[i + 1][j + 1][k];
-				byteArray[6] = vertices[i + 1][j + 1][k + 1];
-				byteArray[7] = vertices[i][j + 1][k + 1];
-				int index = edgeListIndex(byteArray);
-
-				temp = findVertices(i, j, k, index, vertexCoord, vertexVals);
-				triangleVertices.insert(triangleVertices.end(), temp.begin(), temp.end());
-			}
-		}
-	}
-	//std::cout << "mesh complete" << std::endl;
-
-	return triangleVertices;
+// resolution expected to mesh in budget seconds when resolution took seconds.
+// Sampling grows with the cube of the resolution; each step is limited so
+// that one slow frame does not throw away most of the detail
+int fitResolution(int resolution, double seconds, double budget) {
+	double scale = std::cbrt(budget / std::max(seconds, 1e-6));
+	scale = std::min(std::max(scale, 0.8), 1.25);
+	int fitted = (int)(resolution * scale);
+	return std::min(std::max(fitted, MIN_RESOLUTION), MAX_RESOLUTION);
 }
 
-std::vector<GLfloat> genUnion(std::shared_ptr<ImplicitFunc> funcA, std::shared_ptr<ImplicitFunc> funcB, GLfloat cubeSize) {
-	//std::cout << "generating mesh..." << std::endl;
-	GLfloat minX = -cubeSize;
-	GLfloat minY = -cubeSize;
-	GLfloat minZ = -cubeSize;
-	GLfloat maxX = cubeSize;
-	GLfloat maxY = cubeSize;
-	GLfloat maxZ = cubeSize;
-	GLfloat x, y, z, a;
-	bool byteArray[8];
-
-	const GLint dim = 100;
-
-	bool vertices[dim][dim][dim];
-	std::vector<std::vector<std::vector<GLfloat>>> vertexVals(dim, std::vector<std::vector<GLfloat>>(dim, std::vector<GLfloat>(dim, 0.0)));
+// upload current to its own buffers. Their bindings are set here, as the
+// frame leaves no vertex array bound and chunks bind their own buffers
+void uploadCurrent() {
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	current.bindBuffer();
+}
 
-	std::map<HKey, GLfloat> vert_dic;
+// vertices transformed per triangle (ACMR) and per vertex (ATVR) through the
+// post-transform cache, before and after optimizeDrawOrder
+void reportDrawOrder(const char *what, const CacheStats &before, const CacheStats &after) {
+	std::cout << what << " draw order: ACMR " << before.acmr << " -> " << after.acmr
+		<< ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
+}
 
-	std::vector<GLfloat> triangleVertices;
-	std::vector<GLfloat> temp;
-	
-	// array of values for x, y, z
-	// vertexCoord[0][] = x's, vertexCoord[1][] = y's, vertex Coord[2][] = z's
-	GLfloat* vertexCoord[3] = { new GLfloat[dim], new GLfloat[dim], new GLfloat[dim] };
-	for (GLint i = 0; i < dim; ++i) {
-		a = ((GLfloat)i / ((GLfloat)dim - 1));
-		x = maxX * a + minX * (1.0f - a);
-		y = maxY * a + minY * (1.0f - a);
-		z = maxZ * a + minZ * (1.0f - a);
-		vertexCoord[0][i] = x;
-		vertexCoord[1][i] = y;
-		vertexCoord[2][i] = z;
+// make surface the current mesh
+void showSurface(Surface surface) {
+	if (OPTIMIZE_DRAW_ORDER) {
+		optimizeDrawOrder(surface);
 	}
+	current = Mesh(0.4f, 0.4f, 0.4f);
+	current.setVPositions(surface.vertices);
+	current.setVIndices(surface.indices);
+	current.setVNormals(surface.normals);
+	current.genBuffer();
+	uploadCurrent();
+}
 
-	// calculate container data
-	for (GLint i = 0; i < dim; ++i) {
-		for (GLint j = 0; j < dim; ++j) {
-			for (GLint k = 0; k < dim; ++k) {
-				x = vertexCoord[0][i];
-				y = vertexCoord[1][j];
-				z = vertexCoord[2][k];
-				vertices[i][j][k] = funcB->isInside(x, y, z);
-				vertexVals[i][j][k] = funcB->function(x, y, z);
-			}
+// the faces are left open, as decimateSurface never moves them, so that the
+// error is measured against the noise alone
+void benchmarkDecimation() {
+	ThreadPool pool(MESH_THREADS);
+	float dim = 1.5;
+	std::shared_ptr<ImplicitFunc> perlinFunc(new PerlinFunc(0.5, -dim, dim, 0.0, 4));
+
+	for (int resolution : BENCHMARK_RESOLUTIONS) {
+		ExtractionConfig config(dim, resolution);
+		config.closeBorder = false;
+		Surface surface = genMesh(perlinFunc, config, &pool);
+		double mean, max;
+		surfaceError(*perlinFunc, surface, mean, max);
+		std::cout << "resolution " << resolution << ": " << surface.triangleCount() << " triangles, error mean "
+			<< mean << " max " << max << ", cell " << 2 * dim / (resolution - 1) << std::endl;
+
+		for (double share : BENCHMARK_SHARES) {
+			DecimationSettings settings;
+			settings.targetTriangles = (size_t)(surface.triangleCount() * share);
+			auto start = std::chrono::steady_clock::now();
+			Surface decimated = decimateSurface(surface, settings);
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+			surfaceError(*perlinFunc, decimated, mean, max);
+			std::cout << "  " << share * 100 << "%: " << decimated.triangleCount() << " of " << settings.targetTriangles
+				<< " triangles, error mean " << mean << " max " << max << ", " << elapsed.count() << " ms" << std::endl;
 		}
 	}
+}
 
-	// determine outer surface
-	for (GLint i = 0; i < dim - 1; ++i) {
-		for (GLint j = 0; j < dim - 1; ++j) {
-			for (GLint k = 0; k < dim - 1; ++k) {
-				byteArray[0] = vertices[i][j][k];
-				byteArray[1] = vertices[i + 1][j][k];
-				byteArray[2] = vertices[i + 1][j][k + 1];
-				byteArray[3] = vertices[i][j][k + 1];
-				byteArray[4] = vertices[i][j + 1][k];
-				byteArray[5] = vertices[i + 1][j + 1][k];
-				byteArray[6] = vertices[i + 1][j + 1][k + 1];
-				byteArray[7] = vertices[i][j + 1][k + 1];
-
-				int index = edgeListIndex(byteArray);
-				findVerts(i, j, k, index, vertexCoord, vertexVals, vert_dic);
-				//triangleVertices.insert(triangleVertices.end(), temp.begin(), temp.end());
+// distance from the centroid of each triangle of surface to where function
+// is 0, to first order: |f| / |grad f|
+void surfaceError(ImplicitFunc &function, const Surface &surface, double &mean, double &max) {
+	mean = max = 0;
+	size_t triangleCount = surface.triangleCount();
+	for (size_t t = 0; t < triangleCount; ++t) {
+		GLfloat centroid[3] = { 0, 0, 0 };
+		for (int corner = 0; corner < 3; ++corner) {
+			for (int axis = 0; axis < 3; ++axis) {
+				centroid[axis] += surface.vertices[3 * surface.indices[3 * t + corner] + axis] / 3;
 			}
 		}
+		GLfloat grad[3];
+		GLfloat value = function.gradient(centroid[0], centroid[1], centroid[2], grad);
+		double length = std::sqrt(grad[0] * grad[0] + grad[1] * grad[1] + grad[2] * grad[2]);
+		double distance = length > 0 ? std::fabs(value) / length : 0;
+		mean += distance;
+		max = std::max(max, distance);
 	}
-
-	// calculate intersection
-	for (GLint i = 0; i < dim; ++i) {
-		for (GLint j = 0; j < dim; ++j) {
-			for (GLint k = 0; k < dim; ++k) {
-				x = vertexCoord[0][i];
-				y = vertexCoord[1][j];
-				z = vertexCoord[2][k];
-				vertices[i][j][k] = funcA->isInside(x, y, z) && funcB->isInside(x, y, z);
-				vertexVals[i][j][k] = funcA->function(x, y, z);
-			}
-		}
+	if (triangleCount > 0) {
+		mean /= triangleCount;
 	}
+}
 
-	// Go through every cube and check vertices;
-	// triangleVertices stores vertices of facets as {x0, y0, z0, x1, y1, z1, ..., xn, yn, zn}
-	for (GLint i = 0; i < dim - 1; ++i) {
-		for (GLint j = 0; j < dim - 1; ++j) {
-			for (GLint k = 0; k < dim - 1; ++k) {
-				byteArray[0] = vertices[i][j][k];
-				byteArray[1] = vertices[i + 1][j][k];
-				byteArray[2] = vertices[i + 1][j][k + 1];
-				byteArray[3] = vertices[i][j][k + 1];
-				byteArray[4] = vertices[i][j + 1][k];
-				byteArray[5] = vertices[i + 1][j + 1][k];
-				byteArray[6] = vertices[i + 1][j + 1][k + 1];
-				byteArray[7] = vertices[i][j + 1][k + 1];
-				int index = edgeListIndex(byteArray);
-
-				temp = findVerts(i, j, k, index, vertexCoord, vertexVals, vert_dic);
-				triangleVertices.insert(triangleVertices.end(), temp.begin(), temp.end());
+// The points are drawn from a fixed seed, so that a failure repeats, and
+// reach past the 256 cells after which the permutation table wraps
+bool checkNoise() {
+	Simplex simplex;
+	std::mt19937 random(1);
+	std::uniform_real_distribution<double> coordinate(-300.0, 300.0);
+
+	bool passed = true;
+	for (int dimensions = 3; dimensions <= 4; ++dimensions) {
+		double low = 1, high = 0, steepest = 0;
+		for (int n = 0; n < NOISE_CHECK_SAMPLES; ++n) {
+			double point[4];
+			for (int axis = 0; axis < 4; ++axis) {
+				point[axis] = coordinate(random);
 			}
+			double value = dimensions == 3 ? simplex.noise(point[0], point[1], point[2])
+				: simplex.noise(point[0], point[1], point[2], point[3]);
+			low = std::min(low, value);
+			high = std::max(high, value);
+			steepest = std::max(steepest, slopeAcrossFace(simplex, dimensions, point, random));
 		}
-	}
-
-	std::cout << "mesh complete" << std::endl;
-
-	return triangleVertices;
-}
 
-
-int edgeListIndex(const bool arr[8]) {
-	int index = 0;
-	int factor = 1;
-	for (int i = 0; i < 8; ++i) {
-		index += arr[i] * factor;
-		factor = 2 * factor;
+		bool inRange = low >= Fbm::NOISE_LOW && high <= Fbm::NOISE_HIGH;
+		bool continuous = steepest <= NOISE_MAX_SLOPE;
+		std::cout << dimensions << "D simplex: range [" << low << ", " << high << "] of [" << Fbm::NOISE_LOW << ", "
+			<< Fbm::NOISE_HIGH << "]" << (inRange ? "" : " FAILED") << ", steepest across a face " << steepest
+			<< " of " << NOISE_MAX_SLOPE << (continuous ? "" : " FAILED") << std::endl;
+		passed = passed && inRange && continuous;
 	}
-	return index;
-}
-
-std::string genKey(int a, int b, int c, int d, int e, int f) {
-	return std::to_string(a) + std::to_string(b) + std::to_string(c) + std::to_string(d) + std::to_string(e) + std::to_string(f);
+	return passed;
 }
 
-std::vector<GLfloat> findVertices(int i, int j, int k, int index,
-	GLfloat* vertex[3], GLfloat*** vals) {
-	std::vector<GLfloat> triangleVertices;
-	int edgeNum;
-	GLfloat intersection;
-	GLfloat aVal, bVal;
-	GLfloat a, b;
-	GLfloat x, y, z;
-	std::string key;
-
-	for (int e = 0; e < 13; ++e) {
-		edgeNum = aCases[index][e];
-		switch (edgeNum) {
-		case -1:
-			return triangleVertices;
-		case 0:
-			y = vertex[1][j];
-			z = vertex[2][k];
-
-			a = vertex[0][i];
-			aVal = vals[i][j][k];
-			b = vertex[0][i + 1];
-			bVal = vals[i + 1][j][k];
-			intersection = interpolate(a, aVal, b, bVal);
-
-			triangleVertices.push_back(intersection);
-			triangleVertices.push_back(y);
-			triangleVertices.push_back(z);
-			break;
-		case 1:
-			x = vertex[0][i + 1];
-			y = vertex[1][j];
-
-			a = vertex[2][k];
-			aVal = vals[i + 1][j][k];
-			b = vertex[2][k + 1];
-			bVal = vals[i + 1][j][k + 1];
-			intersection = interpolate(a, aVal, b, bVal);
-
-			triangleVertices.push_back(x);
-			triangleVertices.push_back(y);
-			triangleVertices.push_back(intersection);
-			break;
-		case 2:
-			y = vertex[1][j];
-			z = vertex[2][k + 1];
-
-			a = vertex[0][i];
-			aVal = vals[i][j][k + 1];
-			b = vertex[0][i + 1];
-			bVal = vals[i + 1][j][k + 1];
-			intersection = interpolate(a, aVal, b, bVal);
-
-			triangleVertices.push_back(intersection);
-			triangleVertices.push_back(y);
-			triangleVertices.push_back(z);
-			break;
-		case 3:
-			x = vertex[0][i];
-			y = vertex[1][j];
-
-			a = vertex[2][k];
-			aVal = vals[i][j][k];
-			b = vertex[2][k + 1];
-			bVal = vals[i][j][k + 1];
-			intersection = interpolate(a, aVal, b, bVal);
-
-			triangleVertices.push_back(x);
-			triangleVertices.push_back(y);
-			triangleVertices.push_back(intersection);
-			break;
-		case 4:
-			y = vertex[1][j + 1];
-			z = vertex[2][k];
-
-			a = vertex[0][i];
-			aVal = vals[i][j + 1][k];
-			b = vertex[0][i + 1];
-			bVal = vals[i + 1][j + 1][k];
-			intersection = interpolate(a, aVal, b, bVal);
-
-			triangleVertices.push_back(intersection);
-			triangleVertices.push_back(y);
-			triangleVertices.push_back(z);
-			break;
-		case 5:
-			x = vertex[0][i + 1];
-			y = vertex[1][j + 1];
-
-			a = vertex[2][k];
-			aVal = vals[i + 1][j + 1][k];
-			b = vertex[2][k + 1];
-			bVal = vals[i + 1][j + 1][k + 1];
-			intersection = interpolate(a, aVal, b, bVal);
-
-			triangleVertices.push_back(x);
-			triangleVertices.push_back(y);
-			triangleVertices.push_back(intersection);
-			break;
-		case 6:
-			y = vertex[1][j + 1];
-			z = vertex[2][k + 1];
-
-			a = vertex[0][i];
-			aVal = vals[i][j + 1][k + 1];
-			b = vertex[0][i + 1];
-			bVal = vals[i + 1][j + 1][k + 1];
-			intersection = interpolate(a, aVal, b, bVal);
-
-			triangleVertices.push_back(intersection);
-			triangleVertices.push_back(y);
-			triangleVertices.push_back(z);
-			break;
-		case 7:
-			x = vertex[0][i];
-			y = vertex[1][j + 1];
-
-			a = vertex[2][k];
-			aVal = vals[i][j + 1][k];
-			b = vertex[2][k + 1];
-			bVal = vals[i][j + 1][k + 1];
-			intersection = interpolate(a, aVal, b, bVal);
-
-			triangleVertices.push_back(x);
-			triangleVertices.push_back(y);
-			triangleVertices.push_back(intersection);
-			break;
-		case 8:
-			x = vertex[0][i];
-			z = vertex[2][k];
-
-			a = vertex[1][j];
-			aVal = vals[i][j][k];
-			b = vertex[1][j + 1];
-			bVal = vals[i][j + 1][k];
-			intersection = interpolate(a, aVal, b, bVal);
-
-			triangleVertices.push_back(x);
-			triangleVertices.push_back(intersection);
-			triangleVertices.push_back(z);
-			break;
-		case 9:
-			x = vertex[0][i + 1];
-			z = vertex[2][k];
-
-			a = vertex[1][j];
-			aVal = vals[i + 1][j][k];
-			b = vertex[1][j + 1];
-			bVal = vals[i + 1][j + 1][k];
-			intersection = interpolate(a, aVal, b, bVal);
-
-			triangleVertices.push_back(x);
-			triangleVertices.push_back(intersection);
-			triangleVertices.push_back(z);
-			break;
-		case 10:
-			x = vertex[0][i + 1];
-			z = vertex[2][k + 1];
-
-			a = vertex[1][j];
-			aVal = vals[i + 1][j][k + 1];
-			b = vertex[1][j + 1];
-			bVal = vals[i + 1][j + 1][k + 1];
-			intersection = interpolate(a, aVal, b, bVal);
-
-			triangleVertices.push_back(x);
-			triangleVertices.push_back(intersection);
-			triangleVertices.push_back(z);
-			break;
-		case 11:
-			x = vertex[0][i];
-			z = vertex[2][k + 1];
-
-			a = vertex[1][j];
-			aVal = vals[i][j][k + 1];
-			b = vertex[1][j + 1];
-			bVal = vals[i][j + 1][k + 1];
-			intersection = interpolate(a, aVal, b, bVal);
-
-			triangleVertices.push_back(x);
-			triangleVertices.push_back(intersection);
-			triangleVertices.push_back(z);
-			break;
-		}
+// Move point onto a face between two simplices and return the slope of the
+// noise across it, in a random direction. In the skewed lattice a whole
+// coordinate is a face of a cube of simplices, and two coordinates with the
+// same fraction are a face inside one
+double slopeAcrossFace(Simplex &simplex, int dimensions, double point[4], std::mt19937 &random) {
+	const double F[5] = { 0, 0, 0, 1.0 / 3.0, 0.30901699437494745 };
+	const double G[5] = { 0, 0, 0, 1.0 / 6.0, 0.1381966011250105 };
+	const double STEP = 1e-6;
+	std::uniform_int_distribution<int> axisOf(0, dimensions - 1);
+	std::normal_distribution<double> direction(0.0, 1.0);
+
+	double skewed[4];
+	double sum = 0;
+	for (int axis = 0; axis < dimensions; ++axis) {
+		sum += point[axis];
 	}
-
-	return triangleVertices;
-}
-
-void setHKey(struct HKey *key, int a, int b, int c, int d, int e, int f) {
-	key->a = a;
-	key->b = b;
-	key->c = c;
-	key->d = d;
-	key->e = e;
-	key->f = f;
-}
-
-std::vector<GLfloat> findVerts(int i, int j, int k, int index,
-	GLfloat* vertex[3], std::vector<std::vector<std::vector<GLfloat>>> &vals, std::map<HKey, GLfloat> &vert_dic) {
-	std::vector<GLfloat> triangleVertices;
-	int edgeNum;
-	GLfloat intersection;
-	GLfloat aVal, bVal;
-	GLfloat a, b;
-	GLfloat x, y, z;
-	struct HKey key;
-
-	for (int e = 0; e < 13; ++e) {
-		edgeNum = aCases[index][e];
-		switch (edgeNum) {
-		case -1:
-			return triangleVertices;
-		case 0:
-			y = vertex[1][j];
-			z = vertex[2][k];
-			setHKey(&key, i, j, k, i + 1, j, k );
-
-			if (vert_dic.count(key) != 0) {
-				intersection = vert_dic.at(key);
-			}
-			else {
-				a = vertex[0][i];
-				aVal = vals[i][j][k];
-				b = vertex[0][i + 1];
-				bVal = vals[i + 1][j][k];
-				intersection = interpolate(a, aVal, b, bVal);
-				vert_dic.insert(std::pair<HKey, GLfloat>(key, intersection));
-			}
-
-			triangleVertices.push_back(intersection);
-			triangleVertices.push_back(y);
-			triangleVertices.push_back(z);
-			break;
-		case 1:
-			x = vertex[0][i + 1];
-			y = vertex[1][j];
-			setHKey(&key, i + 1, j, k, i + 1, j, k + 1);
-			
-			if (vert_dic.count(key) != 0) {
-				intersection = vert_dic.at(key);
-			}
-			else {
-				a = vertex[2][k];
-				aVal = vals[i + 1][j][k];
-				b = vertex[2][k + 1];
-				bVal = vals[i + 1][j][k + 1];
-				intersection = interpolate(a, aVal, b, bVal);
-				vert_dic.insert(std::pair<HKey, GLfloat>(key, intersection));
-			}
-
-			triangleVertices.push_back(x);
-			triangleVertices.push_back(y);
-			triangleVertices.push_back(intersection);
-			break;
-		case 2:
-			y = vertex[1][j];
-			z = vertex[2][k + 1];
-			setHKey(&key, i, j, k + 1, i + 1, j, k + 1 );
-
-			if (vert_dic.count(key) != 0) {
-				intersection = vert_dic.at(key);
-			}
-			else {
-				a = vertex[0][i];
-				aVal = vals[i][j][k + 1];
-				b = vertex[0][i + 1];
-				bVal = vals[i + 1][j][k + 1];
-				intersection = interpolate(a, aVal, b, bVal);
-				vert_dic.insert(std::pair<HKey, GLfloat>(key, intersection));
-			}
-
-			triangleVertices.push_back(intersection);
-			triangleVertices.push_back(y);
-			triangleVertices.push_back(z);
-			break;
-		case 3:
-			x = vertex[0][i];
-			y = vertex[1][j];
-			setHKey(&key, i, j, k, i, j, k + 1);
-
-			if (vert_dic.count(key) != 0) {
-				intersection = vert_dic.at(key);
-			}
-			else {
-				a = vertex[2][k];
-				aVal = vals[i][j][k];
-				b = vertex[2][k + 1];
-				bVal = vals[i][j][k + 1];
-				intersection = interpolate(a, aVal, b, bVal);
-				vert_dic.insert(std::pair<HKey, GLfloat>(key, intersection));
-			}
-
-			triangleVertices.push_back(x);
-			triangleVertices.push_back(y);
-			triangleVertices.push_back(intersection);
-			break;
-		case 4:
-			y = vertex[1][j + 1];
-			z = vertex[2][k];
-			setHKey(&key, i, j + 1, k, i + 1, j + 1, k);
-
-			if (vert_dic.count(key) != 0) {
-				intersection = vert_dic.at(key);
-			}
-			else {
-				a = vertex[0][i];
-				aVal = vals[i][j + 1][k];
-				b = vertex[0][i + 1];
-				bVal = vals[i + 1][j + 1][k];
-				intersection = interpolate(a, aVal, b, bVal);
-				vert_dic.insert(std::pair<HKey, GLfloat>(key, intersection));
-			}
-
-			triangleVertices.push_back(intersection);
-			triangleVertices.push_back(y);
-			triangleVertices.push_back(z);
-			break;
-		case 5:
-			x = vertex[0][i + 1];
-			y = vertex[1][j + 1];
-			setHKey(&key, i + 1, j + 1, k, i + 1, j + 1, k + 1);
-
-			if (vert_dic.count(key) != 0) {
-				intersection = vert_dic.at(key);
-			}
-			else {
-				a = vertex[2][k];
-				aVal = vals[i + 1][j + 1][k];
-				b = vertex[2][k + 1];
-				bVal = vals[i + 1][j + 1][k + 1];
-				intersection = interpolate(a, aVal, b, bVal);
-				vert_dic.insert(std::pair<HKey, GLfloat>(key, intersection));
-			}
-
-			triangleVertices.push_back(x);
-			triangleVertices.push_back(y);
-			triangleVertices.push_back(intersection);
-			break;
-		case 6:
-			y = vertex[1][j + 1];
-			z = vertex[2][k + 1];
-			setHKey(&key, i, j + 1, k + 1, i + 1, j + 1, k + 1);
-
-			if (vert_dic.count(key) != 0) {
-				intersection = vert_dic.at(key);
-			}
-			else {
-				a = vertex[0][i];
-				aVal = vals[i][j + 1][k + 1];
-				b = vertex[0][i + 1];
-				bVal = vals[i + 1][j + 1][k + 1];
-				intersection = interpolate(a, aVal, b, bVal);
-				vert_dic.insert(std::pair<HKey, GLfloat>(key, intersection));
-			}
-
-			triangleVertices.push_back(intersection);
-			triangleVertices.push_back(y);
-			triangleVertices.push_back(z);
-			break;
-		case 7:
-			x = vertex[0][i];
-			y = vertex[1][j + 1];
-			setHKey(&key, i, j + 1, k, i, j + 1, k + 1 );
-
-			if (vert_dic.count(key) != 0) {
-				intersection = vert_dic.at(key);
-			}
-			else {
-				a = vertex[2][k];
-				aVal = vals[i][j + 1][k];
-				b = vertex[2][k + 1];
-				bVal = vals[i][j + 1][k + 1];
-				intersection = interpolate(a, aVal, b, bVal);
-				vert_dic.insert(std::pair<HKey, GLfloat>(key, intersection));
-			}
-
-			triangleVertices.push_back(x);
-			triangleVertices.push_back(y);
-			triangleVertices.push_back(intersection);
-			break;
-		case 8:
-			x = vertex[0][i];
-			z = vertex[2][k];
-			setHKey(&key, i, j, k, i, j + 1, k );
-
-			if (vert_dic.count(key) != 0) {
-				intersection = vert_dic.at(key);
-			}
-			else {
-				a = vertex[1][j];
-				aVal = vals[i][j][k];
-				b = vertex[1][j + 1];
-				bVal = vals[i][j + 1][k];
-				intersection = interpolate(a, aVal, b, bVal);
-				vert_dic.insert(std::pair<HKey, GLfloat>(key, intersection));
-			}
-
-			triangleVertices.push_back(x);
-			triangleVertices.push_back(intersection);
-			triangleVertices.push_back(z);
-			break;
-		case 9:
-			x = vertex[0][i + 1];
-			z = vertex[2][k];
-			setHKey(&key, i + 1, j, k, i + 1, j + 1, k);
-
-			if (vert_dic.count(key) != 0) {
-				intersection = vert_dic.at(key);
-			}
-			else {
-				a = vertex[1][j];
-				aVal = vals[i + 1][j][k];
-				b = vertex[1][j + 1];
-				bVal = vals[i + 1][j + 1][k];
-				intersection = interpolate(a, aVal, b, bVal);
-				vert_dic.insert(std::pair<HKey, GLfloat>(key, intersection));
-			}
-
-			triangleVertices.push_back(x);
-			triangleVertices.push_back(intersection);
-			triangleVertices.push_back(z);
-			break;
-		case 10:
-			x = vertex[0][i + 1];
-			z = vertex[2][k + 1];
-			setHKey(&key, i + 1, j, k + 1, i + 1, j + 1, k + 1);
-
-			if (vert_dic.count(key) != 0) {
-				intersection = vert_dic.at(key);
-			}
-			else {
-				a = vertex[1][j];
-				aVal = vals[i + 1][j][k + 1];
-				b = vertex[1][j + 1];
-				bVal = vals[i + 1][j + 1][k + 1];
-				intersection = interpolate(a, aVal, b, bVal);
-				vert_dic.insert(std::pair<HKey, GLfloat>(key, intersection));
-			}
-
-			triangleVertices.push_back(x);
-			triangleVertices.push_back(intersection);
-			triangleVertices.push_back(z);
-			break;
-		case 11:
-			x = vertex[0][i];
-			z = vertex[2][k + 1];
-			setHKey(&key, i, j, k + 1, i, j + 1, k + 1);
-
-			if (vert_dic.count(key) != 0) {
-				intersection = vert_dic.at(key);
-			}
-			else {
-				a = vertex[1][j];
-				aVal = vals[i][j][k + 1];
-				b = vertex[1][j + 1];
-				bVal = vals[i][j + 1][k + 1];
-				intersection = interpolate(a, aVal, b, bVal);
-				vert_dic.insert(std::pair<HKey, GLfloat>(key, intersection));
-			}
-
-			triangleVertices.push_back(x);
-			triangleVertices.push_back(intersection);
-			triangleVertices.push_back(z);
-			break;
-		}
+	for (int axis = 0; axis < dimensions; ++axis) {
+		skewed[axis] = point[axis] + sum * F[dimensions];
 	}
-
-	return triangleVertices;
-}
-
-bool isBetween(GLfloat val, GLfloat a, GLfloat b) {
-	if (a > b) {
-		return val >= b && val <= a;
+	int a = axisOf(random);
+	int b = axisOf(random);
+	if (a == b) {
+		skewed[a] = std::floor(skewed[a] + 0.5);
 	}
 	else {
-		return val >= a && val <= b;
+		skewed[b] = std::floor(skewed[b]) + skewed[a] - std::floor(skewed[a]);
+	}
+	sum = 0;
+	for (int axis = 0; axis < dimensions; ++axis) {
+		sum += skewed[axis];
 	}
-}
 
-GLfloat interpolate(GLfloat a, GLfloat aVal, GLfloat b, GLfloat bVal) {
-	GLfloat val = a + ((0 - aVal) * (b - a) / (bVal - aVal));
-	if (isBetween(val, a, b)) {
-		return val;
+	double step[4] = { 0, 0, 0, 0 };
+	double length = 0;
+	for (int axis = 0; axis < dimensions; ++axis) {
+		step[axis] = direction(random);
+		length += step[axis] * step[axis];
 	}
-	else {
-		return a;
+	double ends[2][4];
+	for (int end = 0; end < 2; ++end) {
+		for (int axis = 0; axis < 4; ++axis) {
+			double face = axis < dimensions ? skewed[axis] - sum * G[dimensions] : point[axis];
+			ends[end][axis] = face + (end == 0 ? -STEP : STEP) * step[axis] / std::sqrt(length);
+		}
 	}
+	double rise = dimensions == 3
+		? simplex.noise(ends[1][0], ends[1][1], ends[1][2]) - simplex.noise(ends[0][0], ends[0][1], ends[0][2])
+		: simplex.noise(ends[1][0], ends[1][1], ends[1][2], ends[1][3]) - simplex.noise(ends[0][0], ends[0][1], ends[0][2], ends[0][3]);
+	return std::fabs(rise) / (2 * STEP);
 }
 
 void saveFrame() {
@@ -16,12 +16,22 @@ Mesh::Mesh(const Mesh &mesh) {
 	this->faceColor = mesh.faceColor;
 	this->vBuffer = mesh.vBuffer;
 	this->vNormals = mesh.vNormals;
+	this->vIndices = mesh.vIndices;
 }
 
 void Mesh::setVPositions(std::vector<GLfloat> vPos) {
 	this->vPositions = vPos;
 }
 
+void Mesh::setVIndices(std::vector<GLuint> vInd) {
+	this->vIndices = vInd;
+}
+
+// normals made with the positions, in place of genVNormals
+void Mesh::setVNormals(std::vector<GLfloat> vNorm) {
+	this->vNormals = vNorm;
+}
+
 std::vector<GLfloat> Mesh::calculateVNormals(GLfloat Ax, GLfloat Ay, GLfloat Az, GLfloat Bx, GLfloat By, GLfloat Bz, GLfloat Cx, GLfloat Cy, GLfloat Cz) {
 
 	std::vector<GLfloat> normals(3, 0.f);
@@ -54,7 +64,47 @@ void Mesh::genVNormals() {
 	std::vector<GLfloat> normal(3, 0.f);
 	std::vector<GLfloat> vNormals(vPositions.size(), 0.f);
 
-	for (int i = 0; i < vPositions.size(); i += 9) {
+	// shared vertices average the normals of the facets around them
+	if (!vIndices.empty()) {
+		for (size_t i = 0; i < vIndices.size(); i += 3) {
+			GLuint a = 3 * vIndices[i];
+			GLuint b = 3 * vIndices[i + 1];
+			GLuint c = 3 * vIndices[i + 2];
+			normal = calculateVNormals(vPositions[a],
+				vPositions[a + 1],
+				vPositions[a + 2],
+				vPositions[b],
+				vPositions[b + 1],
+				vPositions[b + 2],
+				vPositions[c],
+				vPositions[c + 1],
+				vPositions[c + 2]);
+
+			// degenerate facets have no direction to contribute
+			if (normal[0] != normal[0]) {
+				continue;
+			}
+
+			for (int n = 0; n < 3; ++n) {
+				vNormals[a + n] += normal[n];
+				vNormals[b + n] += normal[n];
+				vNormals[c + n] += normal[n];
+			}
+		}
+
+		for (size_t i = 0; i < vNormals.size(); i += 3) {
+			GLfloat mag = sqrt(vNormals[i] * vNormals[i] + vNormals[i + 1] * vNormals[i + 1] + vNormals[i + 2] * vNormals[i + 2]);
+			if (mag > 0) {
+				vNormals[i] /= mag;
+				vNormals[i + 1] /= mag;
+				vNormals[i + 2] /= mag;
+			}
+		}
+		this->vNormals = vNormals;
+		return;
+	}
+
+	for (size_t i = 0; i < vPositions.size(); i += 9) {
 		normal = calculateVNormals(vPositions[i],
 			vPositions[i + 1],
 			vPositions[i + 2],
@@ -88,7 +138,7 @@ void Mesh::genBuffer() {
 	std::vector<GLfloat> buffer(vPositions.size() * 3, 0.0f);
 
 	int count = 0;
-	for (int i = 0; i < vPositions.size() * 3; i += 9) {
+	for (size_t i = 0; i < vPositions.size() * 3; i += 9) {
 		// vertex position
 		buffer[i] = vPositions[count];
 		buffer[i + 1] = vPositions[count + 1];
@@ -119,6 +169,11 @@ void Mesh::bindBuffer() {
 
 	glBufferData(GL_ARRAY_BUFFER, vBuffer.size() * sizeof(GLfloat), &vBuffer[0], GL_STATIC_DRAW);
 
+	// indexed meshes also need the element buffer bound to the vertex array
+	if (!vIndices.empty()) {
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, vIndices.size() * sizeof(GLuint), &vIndices[0], GL_STATIC_DRAW);
+	}
+
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), (GLvoid *)0);
 	glEnableVertexAttribArray(0);
 
@@ -131,6 +186,15 @@ void Mesh::bindBuffer() {
 	glBindVertexArray(0);
 }
 
+void Mesh::draw() {
+	if (vIndices.empty()) {
+		glDrawArrays(GL_TRIANGLES, 0, vPositions.size() / 3);
+	}
+	else {
+		glDrawElements(GL_TRIANGLES, vIndices.size(), GL_UNSIGNED_INT, (GLvoid *)0);
+	}
+}
+
 std::vector<GLfloat> Mesh::getVBuffer() {
 	return this->vBuffer;
 }
@@ -10,16 +10,20 @@ public:
 	std::vector<GLfloat> vPositions;
 	std::vector<GLfloat> faceColor;
 	std::vector<GLfloat> vNormals;
+	std::vector<GLuint> vIndices;
 
 	Mesh();
 	Mesh(GLfloat R, GLfloat G, GLfloat B);
 	Mesh(const Mesh &mesh);
 
 	void setVPositions(std::vector<GLfloat> vPos);
+	void setVIndices(std::vector<GLuint> vInd);
+	void setVNormals(std::vector<GLfloat> vNorm);
 	std::vector<GLfloat> calculateVNormals(GLfloat Ax, GLfloat Ay, GLfloat Az, GLfloat Bx, GLfloat By, GLfloat Bz, GLfloat Cx, GLfloat Cy, GLfloat Cz);
 	void addTriangle(std::vector<GLfloat> vPos);
 	void genBuffer();
 	void bindBuffer();
+	void draw();
 	void genVNormals();
 	std::vector<GLfloat> getVBuffer();
 	void reset();